@@ -0,0 +1,117 @@
+#ifndef CPPREADY_TRADER_GO_ARBITRAGE_H
+#define CPPREADY_TRADER_GO_ARBITRAGE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+#include <ready_trader_go/types.h>
+
+#include "constants.h"
+#include "marketdata.h"
+
+// Fees in basis points so edges can be compared in integers. Hedges on the
+// future are free, only the ETF leg pays; IOC orders never rest, so they
+// never earn MAKER_FEE.
+constexpr long FEE_SCALE = 10000;
+constexpr long TAKER_FEE_BP = (long)(TAKER_FEE * FEE_SCALE + 0.5);
+
+// Cross-instrument edge found in one pair of books. The ETF leg is an IOC
+// at price for volume lots, the future leg a hedge for the same volume.
+struct ArbitrageOpportunity {
+    unsigned long price = 0, volume = 0;
+};
+
+// Scaled edge per lot, after the ETF taker fee, of selling the ETF at etf
+// and buying the future at future (Side::SELL) or the other way around
+template<ReadyTraderGo::Side EtfSide>
+inline long ArbitrageEdge(long etf, long future) {
+    if constexpr (EtfSide == ReadyTraderGo::Side::SELL)
+        return etf * (FEE_SCALE - TAKER_FEE_BP) - future * FEE_SCALE;
+    else
+        return future * FEE_SCALE - etf * (FEE_SCALE + TAKER_FEE_BP);
+}
+
+// Scans all levels of both books for lots that can be traded at an edge
+// above minEdge cents, branch free so the compiler can unroll and vectorise
+// it. etf is the side of the ETF book we trade against (bids when selling),
+// future the opposite side of the future book. Every ETF level down to the
+// returned limit price is profitable against every future level counted.
+template<ReadyTraderGo::Side EtfSide>
+inline ArbitrageOpportunity ScanArbitrage(const BookSnapshot::Levels& etfPrices, const BookSnapshot::Levels& etfVolumes,
+                                          const BookSnapshot::Levels& futurePrices,
+                                          const BookSnapshot::Levels& futureVolumes, long minEdge) {
+    constexpr size_t LEVELS = ReadyTraderGo::TOP_LEVEL_COUNT;
+    const long threshold = minEdge * FEE_SCALE;
+    const long bestFuture = (long)futurePrices[0];
+
+    // ETF levels against the best future price. Levels are sorted, so the
+    // profitable ones form a prefix and the limit is the last of them.
+    unsigned long etfVolume = 0, etfLevels = 0;
+    for (size_t i = 0; i < LEVELS; i++) {
+        unsigned long mask = 0UL - (unsigned long)((ArbitrageEdge<EtfSide>((long)etfPrices[i], bestFuture) > threshold)
+                                                   & (etfPrices[i] != 0) & (bestFuture != 0));
+        etfVolume += etfVolumes[i] & mask;
+        etfLevels += mask & 1;
+    }
+    const unsigned long limit = etfPrices[etfLevels - (etfLevels != 0)];
+
+    // Future levels that still pay against the limit
+    unsigned long futureVolume = 0;
+    for (size_t i = 0; i < LEVELS; i++) {
+        unsigned long mask = 0UL - (unsigned long)((ArbitrageEdge<EtfSide>((long)limit, (long)futurePrices[i]) > threshold)
+                                                   & (futurePrices[i] != 0));
+        futureVolume += futureVolumes[i] & mask;
+    }
+
+    ArbitrageOpportunity opportunity;
+    opportunity.price = limit;
+    opportunity.volume = std::min(etfVolume, futureVolume);
+    return opportunity;
+}
+
+// IOC orders of the arbitrage subtrader. They are hedged in full when sent,
+// so fills only move the position, and the unfilled rest is unwound with a
+// second hedge once the final status arrives.
+struct ArbitrageOrder {
+    unsigned long orderId = 0;
+    unsigned long volume = 0;     // as sent and hedged
+    unsigned long remaining = 0;  // not filled yet
+    ReadyTraderGo::Side side = ReadyTraderGo::Side::BUY;
+};
+
+class ArbitrageTracker {
+public:
+    // The trader keeps at most one IOC per side in flight
+    static constexpr size_t CAPACITY = 2;
+
+    bool InFlight(ReadyTraderGo::Side side) const {
+        return std::any_of(mOrders.begin(), mOrders.end(),
+                           [side](const ArbitrageOrder& order) { return order.orderId != 0 && order.side == side; });
+    }
+
+    void Track(unsigned long orderId, ReadyTraderGo::Side side, unsigned long volume) {
+        for (ArbitrageOrder& order : mOrders) {
+            if (order.orderId == 0) {
+                order.orderId = orderId;
+                order.side = side;
+                order.volume = order.remaining = volume;
+                return;
+            }
+        }
+    }
+
+    ArbitrageOrder* Find(unsigned long orderId) {
+        for (ArbitrageOrder& order : mOrders)
+            if (order.orderId == orderId && orderId != 0)
+                return &order;
+        return nullptr;
+    }
+
+    void Release(ArbitrageOrder* order) { *order = ArbitrageOrder(); }
+
+private:
+    std::array<ArbitrageOrder, CAPACITY> mOrders{};
+};
+
+#endif //CPPREADY_TRADER_GO_ARBITRAGE_H
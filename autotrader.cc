@@ -16,53 +16,218 @@
 //     License along with Ready Trader Go.  If not, see
 //     <https://www.gnu.org/licenses/>.
 #include <array>
+#include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <type_traits>
 
 #include <boost/asio/io_context.hpp>
-
-#include <cmath>
+#include <boost/asio/post.hpp>
 
 #include "autotrader.h"
 
-#define RELEASE
+using namespace ReadyTraderGo;
 
-#ifdef RELEASE
-#define IF_DBG if (false)
-#define IF_DBG_RLOG(loggerName,logLevel) IF_DBG std::cout
-#elif
-#define IF_DBG if (true)
-#define IF_DBG_RLOG(loggerName,logLevel) RLOG(loggerName,logLevel)
-#endif
+AutoTrader::AutoTrader(boost::asio::io_context& context, const Clock& clock, const StrategyParameters& params)
+    : AutoTrader(context, clock, params, false)
+{
+    // The environment configures the live trader only, replays and sweeps
+    // run many traders side by side that must not share its files
+    const bool live = &clock == &Clock::System();
+    if (const char* path = live ? std::getenv("AUTOTRADER_JOURNAL") : nullptr) {
+        if (!mJournal.Open(path))
+            RLOG(LG_AT, LogLevel::LL_ERROR) << "cannot open journal " << path;
+    }
+    if (const char* path = live ? std::getenv("AUTOTRADER_CHECKPOINT") : nullptr) {
+        if (!mCheckpoint.Open(path))
+            RLOG(LG_AT, LogLevel::LL_ERROR) << "cannot open checkpoint " << path;
+        else if (const CheckpointState* state = mCheckpoint.Last(clock.Now()))
+            Restore(*state);
+        else
+            RLOG(LG_AT, LogLevel::LL_INFO) << "no checkpoint of the current session in " << path;
+    }
+    // Live trading only, a spinning reactor would never let a replay's poll return
+    LowLatencyOptions options;
+    if (live && LowLatencyOptions::FromEnvironment(options)) {
+        mRuntime.Start(options);
+        WarmUp(options.warmUpRounds);
+    }
+    // Only the live trader owns the process's SIGUSR1
+    if (live) {
+        mDumpSignal.add(SIGUSR1);
+        WaitForDumpSignal();
+    }
+}
 
+AutoTrader::AutoTrader(boost::asio::io_context& context, const Clock& clock, const StrategyParameters& params,
+                       bool dryRun)
+    : BaseAutoTrader(context),
+      mParams(params),
+      mDryRun(dryRun),
+      mClock(clock),
+      mSkew(params),
+      mSessionStart(ToEventTime(clock.Now())),
+      mJournal(clock),
+      mThrottle(context, clock, [this](const OutboundMessage& message) { Dispatch(message); },
+                [this](const OutboundMessage& insert) {
+                    mPairs.ForOrder(insert.clientOrderId, [&](auto& pair) { pair.Withdrawn(insert.clientOrderId); });
+                }),
+      mPairs(*this),
+      mDumpSignal(context),
+      mRuntime(context)
+{
+}
 
-using namespace ReadyTraderGo;
+void AutoTrader::WarmUp(int rounds)
+{
+    boost::asio::io_context context;
+    SimulatedClock clock;
+    std::unique_ptr<AutoTrader> scratch(new AutoTrader(context, clock, mParams, true));
+
+    std::array<unsigned long, TOP_LEVEL_COUNT> askPrices{}, askVolumes{}, bidPrices{}, bidVolumes{};
+    askVolumes.fill(100);
+    bidVolumes.fill(100);
+    std::array<Order, MAX_TRACKED_ORDERS * TradedPairs::COUNT> pending{};
+    for (int round = 0; round < rounds; round++) {
+        clock.Advance(boost::posix_time::milliseconds(250));
+        // A mid wandering over a few ticks makes the passes insert, amend and cancel
+        const unsigned long mid = (10000 + (unsigned long)(round % 7)) * TICK_SIZE_IN_CENTS;
+        for (size_t i = 0; i < TOP_LEVEL_COUNT; i++) {
+            bidPrices[i] = mid - (i + 1) * TICK_SIZE_IN_CENTS;
+            askPrices[i] = mid + (i + 1) * TICK_SIZE_IN_CENTS;
+        }
+        const unsigned long sequence = (unsigned long)round + 1;
+        scratch->mPairs.ForEach([&](auto& pair) {
+            using Instruments = typename std::decay_t<decltype(pair)>::Instruments;
+            scratch->OrderBookMessageHandler(Instruments::FUTURE_INSTRUMENT, sequence, askPrices, askVolumes, bidPrices,
+                                             bidVolumes);
+            scratch->OrderBookMessageHandler(Instruments::ETF_INSTRUMENT, sequence, askPrices, askVolumes, bidPrices,
+                                             bidVolumes);
+            scratch->TradeTicksMessageHandler(Instruments::ETF_INSTRUMENT, sequence, askPrices, askVolumes, bidPrices,
+                                              bidVolumes);
+        });
+        context.restart();
+        context.poll();
+
+        // Answer whatever the pass sent the way the exchange would, copied
+        // first because the answers change the ladders
+        size_t count = 0;
+        scratch->mPairs.ForEach([&](auto& pair) {
+            for (Side side : {Side::BUY, Side::SELL})
+                pair.Orders().ForEach(side, [&](Order& order) { pending[count++] = order; });
+        });
+        for (size_t i = 0; i < count; i++) {
+            const Order& order = pending[i];
+            if (order.state == OrderState::PENDING_CANCEL)
+                scratch->OrderStatusMessageHandler(order.orderId, 0, 0, 0);
+            else if (order.state == OrderState::PENDING_AMEND)
+                scratch->OrderStatusMessageHandler(order.orderId, order.filled, order.amendVolume - order.filled, 0);
+            else if (order.state == OrderState::PENDING_NEW)
+                scratch->OrderStatusMessageHandler(order.orderId, order.filled, order.volume, 0);
+        }
+
+        // One lot filled per round, alternating sides so the position stays flat
+        if (count != 0) {
+            const Order& order = pending[round % 2 == 0 ? 0 : count - 1];
+            scratch->OrderFilledMessageHandler(order.orderId, order.price, 1);
+            context.restart();
+            context.poll();
+            // The hedge the fill's pair just sent
+            scratch->HedgeFilledMessageHandler(OrderIdFor(scratch->mNextMessageId - 1, PairOfOrder(order.orderId)), mid, 1);
+        }
+    }
+    RLOG(LG_AT, LogLevel::LL_INFO) << "warmed up with " << rounds << " synthetic books";
+}
+
+void AutoTrader::Restore(const CheckpointState& state)
+{
+    // Ids handed out after the last checkpoint was written are skipped
+    mNextMessageId = state.nextMessageId + 1024;
+    mSessionStart = state.sessionStart;
+    const unsigned long restoredBelow = OrderIdFor(mNextMessageId, 0);
+    mPairs.ForEach([&](auto& pair) { pair.Restore(state.pairs[pair.PAIR_INDEX], restoredBelow); });
+    RLOG(LG_AT, LogLevel::LL_INFO) << "restored checkpoint " << state.generation;
+}
+
+void AutoTrader::Checkpoint()
+{
+    if (!mCheckpoint.IsOpen())
+        return;
+    CheckpointState& state = mCheckpoint.Begin();
+    state.sessionStart = mSessionStart;
+    state.written = ToEventTime(mClock.Now());
+    state.nextMessageId = mNextMessageId;
+    mPairs.ForEach([&](auto& pair) { pair.Save(state.pairs[pair.PAIR_INDEX]); });
+    mCheckpoint.Commit();
+}
 
-time_duration MessageFrequencyTracker::PeriodLength = boost::posix_time::seconds(1);
+ptime AutoTrader::NextHedgeFlush()
+{
+    ptime next(boost::posix_time::not_a_date_time);
+    mPairs.ForEach([&](auto& pair) {
+        const ptime due = pair.Hedges().NextFlushTime();
+        if (!due.is_not_a_date_time() && (next.is_not_a_date_time() || due < next))
+            next = due;
+    });
+    return next;
+}
 
-AutoTrader::AutoTrader(boost::asio::io_context& context) : BaseAutoTrader(context)
+void AutoTrader::FlushHedgesIfDue()
 {
+    mPairs.ForEach([](auto& pair) { pair.Hedges().FlushIfDue(); });
+}
+
+void AutoTrader::WaitForDumpSignal()
+{
+    mDumpSignal.async_wait([this](const boost::system::error_code& error, int) {
+        if (error)
+            return;
+        mLatency.Dump(stderr);
+        WaitForDumpSignal();
+    });
 }
 
 void AutoTrader::DisconnectHandler()
 {
+    ScopedProbe probe(mLatency, Probe::DISCONNECT);
+    mJournal.Event(EventType::DISCONNECT, 0);
     BaseAutoTrader::DisconnectHandler();
+    mRuntime.Stop();
     IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "execution connection lost";
+    mLatency.Dump(stderr);
+    IF_DBG {
+        const ThrottleStats& stats = mThrottle.Stats();
+        RLOG(LG_AT, LogLevel::LL_INFO) << "throttle: " << stats.sentImmediately << " sent immediately, "
+                                       << stats.queued << " queued (max depth " << stats.maxQueueDepth
+                                       << "), " << stats.coalesced << " coalesced, " << stats.withdrawn
+                                       << " withdrawn, max wait " << stats.maxWait;
+    }
 }
 
 void AutoTrader::ErrorMessageHandler(unsigned long clientOrderId,
                                      const std::string& errorMessage)
 {
+    ScopedProbe probe(mLatency, Probe::ERROR);
+    mJournal.ErrorEvent(clientOrderId, errorMessage);
     IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "error with order " << clientOrderId << ": " << errorMessage;
-    if (clientOrderId != 0 && ((mAskOrderIdToOrder.count(clientOrderId) == 1) || (mBidOrderIdToOrder.count(clientOrderId) == 1)))
-    {
+    if (clientOrderId == 0)
+        return;
+
+    bool rejectedAmend = false;
+    mPairs.ForOrder(clientOrderId, [&](auto& pair) { rejectedAmend = pair.OnAmendRejected(clientOrderId); });
+    // Rejected inserts and cancels of orders that are already gone
+    if (!rejectedAmend)
         OrderStatusMessageHandler(clientOrderId, 0, 0, 0);
-    }
 }
 
 void AutoTrader::HedgeFilledMessageHandler(unsigned long clientOrderId,
                                            unsigned long price,
                                            unsigned long volume)
 {
+    ScopedProbe probe(mLatency, Probe::HEDGE_FILLED);
+    mJournal.OrderEvent(EventType::HEDGE_FILLED, clientOrderId, price, volume);
+    mPairs.ForOrder(clientOrderId, [&](auto& pair) { pair.OnHedgeFilled(clientOrderId, volume); });
+    Checkpoint();
     IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "hedge order " << clientOrderId << " filled for " << volume
                                    << " lots at $" << price << " average price in cents";
 }
@@ -74,180 +239,21 @@ void AutoTrader::OrderBookMessageHandler(Instrument instrument,
                                          const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
                                          const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes)
 {
-    if (instrument == FUT) {
-        unsigned long bestBidFut = bidPrices[0];
-        //unsigned long bestBidVolFut = bidVolumes[0];
-        unsigned long bestAskFut = askPrices[0];
-        //unsigned long bestAskVolFut = askVolumes[0];
-
-        // Get out of bad orders right away
-        // Cancel arbitragable bid orders
-        for (unsigned long price : mBidPrices) {
-            if (bestAskFut < price) {
-                unsigned int orderId = mBidToOrder[price]->orderId;
-                SendCancelOrder(orderId);
-                IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "cancelling order " << orderId << " at price " << price;
-            }
-        }
-        // Cancel arbitragable ask orders
-        for (unsigned long price : mAskPrices) {
-            if (bestBidFut > price) {
-                unsigned int orderId = mAskToOrder[price]->orderId;
-                SendCancelOrder(orderId);
-                IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "cancelling order " << orderId << " at price " << price;
-            }
-        }
-
-        // Proper market making code
-        // Minimum position imbalance before a price adjustment can be made
-        constexpr long minPositionImbalance = 50;
-        constexpr double centsPerImbalancedShare = 0.2 / LOT_SIZE;
-        unsigned long priceAdjustment = 0;
-        if (mPosition >= minPositionImbalance) {
-            priceAdjustment = -(int)round(((double)mPosition - (double)minPositionImbalance) * centsPerImbalancedShare);
-        } else if (mPosition <= -minPositionImbalance) {
-            priceAdjustment = -(int)round(((double)mPosition + (double)minPositionImbalance) * centsPerImbalancedShare);
-        }
-        priceAdjustment *= TICK_SIZE_IN_CENTS;
-
-        int numNewOrdersAllowed = mMessageTracker.GetNewOrdersAllowed();
-
-        // Adjust bid side
-        if (bestBidFut != 0) {
-            // Calculate front of my book bid
-            unsigned long frontBid = bestBidFut + priceAdjustment - ADDITIONAL_SPREAD;
-            frontBid = std::min(frontBid, bestAskFut);
-            // Count to compute the maximum bid size
-            // and also mark orders for cancellation that are too far away
-            long maximumBidSize = POSITION_LIMIT - mPosition;
-            for (unsigned int price : mBidPrices) {
-                Order* order = mBidToOrder[price];
-                // Backstop in case mBidPrices, mBidToOrder, and mBidOrderIdToOrder become inconsistent
-                if (order == nullptr)
-                    continue;
-
-                IF_DBG if (mBidToOrder.count(price) == 0) {
-                    RLOG(LG_AT, LogLevel::LL_ERROR) << "mBidPrices and mBidToOrder is inconsistent for price " << price;
-                    RLOG(LG_AT, LogLevel::LL_INFO) << "mBidPrices:";
-                    for (auto& p : mBidPrices) RLOG(LG_AT, LogLevel::LL_INFO) << p;
-                    RLOG(LG_AT, LogLevel::LL_INFO) << "mBidToOrder:";
-                    for (auto& p : mBidToOrder) RLOG(LG_AT, LogLevel::LL_INFO) << p.first << " maps to " << p.second;
-                    RLOG(LG_AT, LogLevel::LL_INFO) << "mBidOrderIdToOrder:";
-                    for (auto& p : mBidOrderIdToOrder) RLOG(LG_AT, LogLevel::LL_INFO) << p.first << " maps to " << p.second;
-                    RLOG(LG_AT, LogLevel::LL_INFO) << std::flush;
-                    return;
-                }
-
-                if (price > frontBid || price <= frontBid - NUM_CLONES * TICK_SIZE_IN_CENTS) {
-                    SendCancelOrder(order->orderId);
-                    // This order will be cancelled, but it will contribute still
-                    // towards reducing the maximum bid size, because it might be
-                    // filled before the cancellation is effective
-                    maximumBidSize -= (long)order->volume;
-                } else {
-                    // Order is fine
-                    maximumBidSize -= (long)order->volume;
-                }
-            }
-            for (unsigned int offset = 0; offset < NUM_CLONES && maximumBidSize > 0 && numNewOrdersAllowed > 0; offset++) {
-                unsigned int price = frontBid - offset * TICK_SIZE_IN_CENTS;
-                if (mBidPrices.count(price) == 0) {
-                    unsigned int volume = std::min((long)LOT_SIZE, maximumBidSize);
-                    unsigned int orderId = mNextMessageId++;
-                    SendInsertOrder(orderId, Side::BUY, price, volume, Lifespan::GOOD_FOR_DAY);
-                    numNewOrdersAllowed--;
-                    auto* order = new Order(price, volume, orderId);
-                    mBidPrices.emplace(price);
-                    mBidToOrder[price] = order;
-                    mBidOrderIdToOrder[orderId] = order;
-                    maximumBidSize -= volume;
-                }
-            }
-        }
-
-        // Adjust ask side
-        if (bestAskFut != 0) {
-            // Calculate front of my book ask
-            unsigned long frontAsk = bestAskFut + priceAdjustment + ADDITIONAL_SPREAD;
-            frontAsk = std::max(frontAsk, bestBidFut);
-            // Count to compute the maximum ask size
-            // and also mark orders for cancellation that are too far away
-            long maximumAskSize = POSITION_LIMIT + mPosition;
-            for (unsigned int price : mAskPrices) {
-                Order* order = mAskToOrder[price];
-                // Backstop in case mAskPrices, mAskToOrder, and mAskOrderIdToOrder become inconsistent
-                if (order == nullptr)
-                    continue;
-
-                IF_DBG if (mAskToOrder.count(price) == 0) {
-                    RLOG(LG_AT, LogLevel::LL_ERROR) << "mAskPrices and mAskToOrder is inconsistent for price " << price;
-                    RLOG(LG_AT, LogLevel::LL_INFO) << "mAskPrices:";
-                    for (auto& p : mAskPrices) RLOG(LG_AT, LogLevel::LL_INFO) << p;
-                    RLOG(LG_AT, LogLevel::LL_INFO) << "mAskToOrder:";
-                    for (auto& p : mAskToOrder) RLOG(LG_AT, LogLevel::LL_INFO) << p.first << " maps to " << p.second;
-                    RLOG(LG_AT, LogLevel::LL_INFO) << "mAskOrderIdToOrder:";
-                    for (auto& p : mAskOrderIdToOrder) RLOG(LG_AT, LogLevel::LL_INFO) << p.first << " maps to " << p.second;
-                    RLOG(LG_AT, LogLevel::LL_INFO) << std::flush;
-                    return;
-                }
-
-                if (price < frontAsk || price >= frontAsk + NUM_CLONES * TICK_SIZE_IN_CENTS) {
-                    SendCancelOrder(order->orderId);
-                    // This order will be cancelled, but it will contribute still
-                    // towards reducing the maximum ask size, because it might be
-                    // filled before the cancellation is effective
-                    maximumAskSize -= (long)order->volume;
-                } else {
-                    // Order is fine
-                    maximumAskSize -= (long)order->volume;
-                }
-            }
-            for (unsigned int offset = 0; offset < NUM_CLONES && maximumAskSize > 0 && numNewOrdersAllowed > 0; offset++) {
-                unsigned int price = frontAsk + offset * TICK_SIZE_IN_CENTS;
-                if (mAskPrices.count(price) == 0) {
-                    unsigned int volume = std::min((long)LOT_SIZE, maximumAskSize);
-                    unsigned int orderId = mNextMessageId++;
-                    SendInsertOrder(orderId, Side::SELL, price, volume, Lifespan::GOOD_FOR_DAY);
-                    numNewOrdersAllowed--;
-                    auto* order = new Order(price, volume, orderId);
-                    mAskPrices.emplace(price);
-                    mAskToOrder[price] = order;
-                    mAskOrderIdToOrder[orderId] = order;
-                    maximumAskSize -= volume;
-                }
-            }
-        }
-    }
-
-    IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "order book received for " << instrument << " instrument"
-                                   << ": ask prices: " << askPrices[0]
-                                   << "; ask volumes: " << askVolumes[0]
-                                   << "; bid prices: " << bidPrices[0]
-                                   << "; bid volumes: " << bidVolumes[0];
-
-    IF_DBG {
-        unsigned long bidQuote = mBidPrices.empty() ? 0 : *mBidPrices.crbegin();
-        unsigned long askQuote = mAskPrices.empty() ? 0 : *mAskPrices.cbegin();
-        RLOG(LG_AT, LogLevel::LL_INFO) << "making market for ETF " << bidQuote << ":" << askQuote;
-    }
+    ScopedProbe probe(mLatency, Probe::ORDER_BOOK);
+    mJournal.BookEvent(EventType::ORDER_BOOK, instrument, sequenceNumber, askPrices, askVolumes, bidPrices, bidVolumes);
+    mPairs.ForInstrument(instrument, [&](auto& pair) {
+        pair.OnOrderBook(instrument, sequenceNumber, askPrices, askVolumes, bidPrices, bidVolumes, probe.Start());
+    });
 }
 
 void AutoTrader::OrderFilledMessageHandler(unsigned long clientOrderId,
                                            unsigned long price,
                                            unsigned long volume)
 {
-    if (mBidOrderIdToOrder.count(clientOrderId) != 0) {
-        SendHedgeOrder(mNextMessageId, Side::SELL, MIN_BID_NEAREST_TICK, volume);
-        mNextMessageId++;
-        mPosition += (long)volume;
-    } else {
-        SendHedgeOrder(mNextMessageId, Side::BUY, MAX_ASK_NEAREST_TICK, volume);
-        mNextMessageId++;
-        mPosition -= (long)volume;
-    }
-
-    IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "order " << clientOrderId << " filled for " << volume
-                                   << " lots at $" << price << " cents";
+    ScopedProbe probe(mLatency, Probe::ORDER_FILLED);
+    mJournal.OrderEvent(EventType::ORDER_FILLED, clientOrderId, price, volume);
+    mPairs.ForOrder(clientOrderId, [&](auto& pair) { pair.OnOrderFilled(clientOrderId, price, volume); });
+    Checkpoint();
 }
 
 void AutoTrader::OrderStatusMessageHandler(unsigned long clientOrderId,
@@ -255,39 +261,10 @@ void AutoTrader::OrderStatusMessageHandler(unsigned long clientOrderId,
                                            unsigned long remainingVolume,
                                            signed long fees)
 {
-    if (mBidOrderIdToOrder.count(clientOrderId) != 0) {
-        if (remainingVolume == 0) {
-            Order* order = mBidOrderIdToOrder[clientOrderId];
-            mBidOrderIdToOrder.erase(clientOrderId);
-            // Backstop in case mBidPrices, mBidToOrder, and mBidOrderIdToOrder become inconsistent
-            if (order == nullptr) {
-                IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << " found inconsistency within bid side order tracking datastructures";
-                return;
-            }
-            mBidToOrder.erase(order->price);
-            mBidPrices.erase(order->price);
-            delete order;
-        } else {
-            mBidOrderIdToOrder[clientOrderId]->volume = remainingVolume;
-        }
-    } else if (mAskOrderIdToOrder.count(clientOrderId) != 0) {
-        if (remainingVolume == 0) {
-            Order* order = mAskOrderIdToOrder[clientOrderId];
-            mAskOrderIdToOrder.erase(clientOrderId);
-            // Backstop in case mAskPrices, mAskToOrder, and mAskOrderIdToOrder become inconsistent
-            if (order == nullptr) {
-                IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << " found inconsistency within ask side order tracking datastructures";
-                return;
-            }
-            mAskToOrder.erase(order->price);
-            mAskPrices.erase(order->price);
-            delete order;
-        } else {
-            mAskOrderIdToOrder[clientOrderId]->volume = remainingVolume;
-        }
-    } else {
-        IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << "unknown order " << clientOrderId << " had an update!";
-    }
+    ScopedProbe probe(mLatency, Probe::ORDER_STATUS);
+    mJournal.OrderEvent(EventType::ORDER_STATUS, clientOrderId, fillVolume, remainingVolume, fees);
+    mPairs.ForOrder(clientOrderId, [&](auto& pair) { pair.OnOrderStatus(clientOrderId, fillVolume, remainingVolume); });
+    Checkpoint();
 }
 
 void AutoTrader::TradeTicksMessageHandler(Instrument instrument,
@@ -297,80 +274,573 @@ void AutoTrader::TradeTicksMessageHandler(Instrument instrument,
                                           const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
                                           const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes)
 {
-    IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "trade ticks received for " << instrument << " instrument"
-                                   << ": ask prices: " << askPrices[0]
-                                   << "; ask volumes: " << askVolumes[0]
-                                   << "; bid prices: " << bidPrices[0]
-                                   << "; bid volumes: " << bidVolumes[0];
+    ScopedProbe probe(mLatency, Probe::TRADE_TICKS);
+    mJournal.BookEvent(EventType::TRADE_TICKS, instrument, sequenceNumber, askPrices, askVolumes, bidPrices, bidVolumes);
+    mPairs.ForInstrument(instrument, [&](auto& pair) {
+        pair.OnTradeTicks(instrument, sequenceNumber, askPrices, askVolumes, bidPrices, bidVolumes);
+    });
 }
 
 void AutoTrader::SendAmendOrder(unsigned long clientOrderId, unsigned long volume)
 {
-    mMessageTracker.NoteMessage();
-    BaseAutoTrader::SendAmendOrder(clientOrderId, volume);
+    ScopedProbe probe(mLatency, Probe::SEND_AMEND);
+    mPairs.ForOrder(clientOrderId, [](auto& pair) { pair.Compliance().NoteMessage(Subtrader::MARKET_MAKING); });
+    OutboundMessage message{OutboundMessage::Type::AMEND, Side::BUY, Lifespan::GOOD_FOR_DAY, clientOrderId, 0, volume, {}};
+    if (mThrottle.Admit(message))
+        Dispatch(message);
     IF_DBG_RLOG(LG_AT, LogLevel::LL_DEBUG) << " sent amend order message";
 }
 
 void AutoTrader::SendCancelOrder(unsigned long clientOrderId)
 {
-    mMessageTracker.NoteMessage();
-    BaseAutoTrader::SendCancelOrder(clientOrderId);
+    ScopedProbe probe(mLatency, Probe::SEND_CANCEL);
+    mLatency.OrderSent();
+    mPairs.ForOrder(clientOrderId, [](auto& pair) { pair.Compliance().NoteMessage(Subtrader::MARKET_MAKING); });
+    OutboundMessage message{OutboundMessage::Type::CANCEL, Side::BUY, Lifespan::GOOD_FOR_DAY, clientOrderId, 0, 0, {}};
+    if (mThrottle.Admit(message))
+        Dispatch(message);
     IF_DBG_RLOG(LG_AT, LogLevel::LL_DEBUG) << " sent cancel order message";
 }
 
 void AutoTrader::SendHedgeOrder(unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume)
 {
-    mMessageTracker.NoteMessage();
-    BaseAutoTrader::SendHedgeOrder(clientOrderId, side, price, volume);
+    ScopedProbe probe(mLatency, Probe::SEND_HEDGE);
+    mPairs.ForOrder(clientOrderId, [&](auto& pair) {
+        pair.Compliance().NoteMessage(Subtrader::HEDGE);
+        pair.Compliance().OnHedge(clientOrderId, side, volume);
+    });
+    OutboundMessage message{OutboundMessage::Type::HEDGE, side, Lifespan::FILL_AND_KILL, clientOrderId, price, volume, {}};
+    if (mThrottle.Admit(message))
+        Dispatch(message);
     IF_DBG_RLOG(LG_AT, LogLevel::LL_DEBUG) << " sent hedge order message";
 }
 
 void AutoTrader::SendInsertOrder(unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume, Lifespan lifespan)
 {
-    mMessageTracker.NoteMessage();
-    BaseAutoTrader::SendInsertOrder(clientOrderId, side, price, volume, lifespan);
+    ScopedProbe probe(mLatency, Probe::SEND_INSERT);
+    mLatency.OrderSent();
+    Subtrader subtrader = lifespan == Lifespan::FILL_AND_KILL ? Subtrader::ARBITRAGE : Subtrader::MARKET_MAKING;
+    mPairs.ForOrder(clientOrderId, [&](auto& pair) {
+        pair.Compliance().NoteMessage(subtrader);
+        pair.Compliance().OnInsert(subtrader, side, volume);
+    });
+    OutboundMessage message{OutboundMessage::Type::INSERT, side, lifespan, clientOrderId, price, volume, {}};
+    if (mThrottle.Admit(message))
+        Dispatch(message);
     IF_DBG_RLOG(LG_AT, LogLevel::LL_DEBUG) << " sent insert order message";
 }
 
-void MessageFrequencyTracker::NoteMessage()
+void AutoTrader::Dispatch(const OutboundMessage& message)
+{
+    if (mDryRun)
+        return;
+    switch (message.type) {
+    case OutboundMessage::Type::AMEND:
+        mJournal.SendEvent(EventType::SEND_AMEND, message.clientOrderId, message.side, message.lifespan, 0, message.volume);
+        BaseAutoTrader::SendAmendOrder(message.clientOrderId, message.volume);
+        break;
+    case OutboundMessage::Type::CANCEL:
+        mJournal.SendEvent(EventType::SEND_CANCEL, message.clientOrderId, message.side, message.lifespan, 0, 0);
+        BaseAutoTrader::SendCancelOrder(message.clientOrderId);
+        break;
+    case OutboundMessage::Type::HEDGE:
+        mJournal.SendEvent(EventType::SEND_HEDGE, message.clientOrderId, message.side, message.lifespan, message.price, message.volume);
+        BaseAutoTrader::SendHedgeOrder(message.clientOrderId, message.side, message.price, message.volume);
+        break;
+    case OutboundMessage::Type::INSERT:
+        mJournal.SendEvent(EventType::SEND_INSERT, message.clientOrderId, message.side, message.lifespan, message.price, message.volume);
+        BaseAutoTrader::SendInsertOrder(message.clientOrderId, message.side, message.price, message.volume, message.lifespan);
+        break;
+    }
+    IF_DBG_RLOG(LG_AT, LogLevel::LL_DEBUG) << " sent message for order " << message.clientOrderId;
+}
+
+template <typename Pair, size_t INDEX>
+PairStrategy<Pair, INDEX>::PairStrategy(AutoTrader& trader)
+    : mTrader(trader),
+      mFlow(trader.mClock),
+      mCompliance(trader.mClock, trader.mThrottle, WithMakingAllowance(trader.mParams.makingAllowance)),
+      mHedges(trader.mContext, trader.mClock, boost::posix_time::microseconds(trader.mParams.hedgeWindowMicros),
+              [this](Side side, unsigned long volume) {
+                  SendHedge(side, volume);
+                  mTrader.Checkpoint();
+              })
+{
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::Restore(const PairCheckpoint& state, unsigned long restoredBelow)
+{
+    // Hedges that were never answered are assumed to have filled in full.
+    // Their ids are not tracked any more, so a HedgeFilled for one arriving
+    // after the restart is ignored and whatever it did not get stays
+    // unhedged. Hedges cross the whole future book at the price limit, so
+    // only a book thinner than the hedge leaves anything behind.
+    mCompliance.Restore(state.positions, state.futurePosition + state.hedgesInFlight);
+    if (state.hedgesInFlight != 0)
+        RLOG(LG_AT, LogLevel::LL_WARNING) << "pair " << INDEX << ": " << state.hedgesInFlight
+                                          << " future lots of unanswered hedges taken as filled";
+    for (std::uint32_t i = 0; i < state.orderCount; i++) {
+        const Order& order = state.orders[i];
+        if (!mOrders.CanTrack(order.side, order.price))
+            continue;
+        mOrders.Track(order.side, order.price, order.volume, order.orderId)->state = OrderState::LIVE;
+        mCompliance.OnInsert(Subtrader::MARKET_MAKING, order.side, order.volume);
+    }
+    mRestoredBelow = restoredBelow;
+    RLOG(LG_AT, LogLevel::LL_INFO) << "restored pair " << INDEX << ": ETF " << mCompliance.EtfPosition() << ", future "
+                                   << mCompliance.FuturePosition() << ", " << state.orderCount << " resting orders";
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::Reconcile()
+{
+    // Future books to wait for the final statuses of the restored orders
+    constexpr int RECONCILE_BOOKS = 4;
+
+    if (mReconcileBooks++ == 0) {
+        // What became of the restored orders is unknown, their final
+        // statuses settle it and the next quoting passes fill the ladder again
+        mOrders.ForEach(Side::BUY, [&](Order& order) { CancelOrder(order); });
+        mOrders.ForEach(Side::SELL, [&](Order& order) { CancelOrder(order); });
+        mHedges.Owe(-(mCompliance.EtfPosition() + mCompliance.FuturePosition()));
+        return;
+    }
+    if (mReconcileBooks <= RECONCILE_BOOKS)
+        return;
+
+    // The exchange ignores cancels of orders it no longer has
+    std::array<unsigned long, MAX_TRACKED_ORDERS> stale{};
+    size_t count = 0;
+    for (Side side : {Side::BUY, Side::SELL})
+        mOrders.ForEach(side, [&](Order& order) {
+            if (order.orderId < mRestoredBelow)
+                stale[count++] = order.orderId;
+        });
+    for (size_t i = 0; i < count; i++) {
+        Order* order = mOrders.Find(stale[i]);
+        mCompliance.OnDone(Subtrader::MARKET_MAKING, order->side, order->volume);
+        mOrders.Release(order);
+    }
+    mRestoredBelow = 0;
+    mMarketData.Invalidate();
+    RLOG(LG_AT, LogLevel::LL_INFO) << "reconciled pair " << INDEX << ", " << count << " restored orders were gone";
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::Save(PairCheckpoint& state)
+{
+    for (size_t i = 0; i < (size_t)Subtrader::COUNT; i++)
+        state.positions[i] = mCompliance.Position((Subtrader)i);
+    state.futurePosition = mCompliance.FuturePosition();
+    state.hedgesInFlight = mCompliance.HedgesInFlight();
+    std::uint32_t count = 0;
+    for (Side side : {Side::BUY, Side::SELL})
+        mOrders.ForEach(side, [&](Order& order) { state.orders[count++] = order; });
+    state.orderCount = count;
+}
+
+template <typename Pair, size_t INDEX>
+bool PairStrategy<Pair, INDEX>::OnAmendRejected(unsigned long clientOrderId)
+{
+    Order* order = mOrders.Find(clientOrderId);
+    if (order == nullptr || order->state != OrderState::PENDING_AMEND)
+        return false;
+    // A rejected amend leaves the order resting with its previous volume
+    order->state = OrderState::LIVE;
+    return true;
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::OnHedgeFilled(unsigned long clientOrderId, unsigned long volume)
+{
+    // Whatever a hedge did not get is owed again, and anything held back
+    // can go out now that the hedge no longer needs tracking
+    mHedges.OnShortfall(mCompliance.OnHedgeFilled(clientOrderId, volume));
+    mHedges.Resume();
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::OnOrderBook(Instrument instrument,
+                                            unsigned long sequenceNumber,
+                                            const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
+                                            const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
+                                            const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
+                                            const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes,
+                                            std::uint64_t arrived)
+{
+    const Instrument role = Pair::Role(instrument);
+    if (!mMarketData.OnOrderBook(role, sequenceNumber, askPrices, askVolumes, bidPrices, bidVolumes)) {
+        IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << "dropped stale order book " << sequenceNumber << " for " << instrument;
+        return;
+    }
+
+    mTrader.mLatency.BookArrived(arrived);
+    if (mRestoredBelow != 0 && role == FUT)
+        Reconcile();
+    // Crosses are a race, take them before anything else happens
+    if (mTrader.mParams.arbitrage && mMarketData.Synchronized() && FindArbitrage())
+        mTrader.Checkpoint();
+
+    if (role == FUT) {
+        // Quote once the reactor has delivered whatever else is ready, so a
+        // burst of books is handled from the latest one only
+        if (mMarketData.RequestPass())
+            boost::asio::post(mTrader.mContext, [this, arrived] { QuotePass(arrived); });
+    }
+    // Books handled before the pass runs must not see this one's arrival
+    mTrader.mLatency.BookHandled();
+
+    IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "order book received for " << instrument << " instrument"
+                                   << ": ask prices: " << askPrices[0]
+                                   << "; ask volumes: " << askVolumes[0]
+                                   << "; bid prices: " << bidPrices[0]
+                                   << "; bid volumes: " << bidVolumes[0];
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::QuotePass(std::uint64_t arrived)
+{
+    LatencyRecorder& latency = mTrader.mLatency;
+    const StrategyParameters& params = mTrader.mParams;
+    ScopedProbe probe(latency, Probe::QUOTE_PASS);
+    latency.BookArrived(arrived);
+    const BookSnapshot& future = mMarketData.Book(FUT);
+    unsigned long bestBidFut = future.BestBid();
+    unsigned long bestAskFut = future.BestAsk();
+    const long position = mCompliance.EtfPosition();
+    // Flow one-sided enough to pick off our quotes, stand further back
+    const bool toxic = params.toxicImbalance > 0 && mFlow.Toxic(ETF, params.toxicImbalance);
+    if (!mMarketData.BeginPass({bestBidFut, bestAskFut, position, toxic})) {
+        latency.BookHandled();
+        return;
+    }
+
+    // Get out of bad orders right away
+    // Cancel arbitragable bid orders
+    mOrders.ForEach(Side::BUY, [&](Order& order) {
+        if (bestAskFut < order.price) {
+            CancelOrder(order);
+            IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "cancelling order " << order.orderId << " at price " << order.price;
+        }
+    });
+    // Cancel arbitragable ask orders
+    mOrders.ForEach(Side::SELL, [&](Order& order) {
+        if (bestBidFut > order.price) {
+            CancelOrder(order);
+            IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "cancelling order " << order.orderId << " at price " << order.price;
+        }
+    });
+
+    // Proper market making code
+    const unsigned long additionalSpread = params.additionalSpread + (toxic ? params.toxicExtraSpread : 0);
+    const int numClones = toxic ? std::min(params.numClones, params.toxicClones) : params.numClones;
+    const QuoteFronts front = QuoteFront(bestBidFut, bestAskFut, mTrader.mSkew.Ticks(position), additionalSpread);
+    int numNewOrdersAllowed = mCompliance.NewOrdersAllowed(Subtrader::MARKET_MAKING);
+
+    // A side without a front is left alone, its bids stop short of price 0
+    if (front.bid != 0)
+        ReconcileQuotes(Side::BUY, front.bid, std::min(numClones, (int)(front.bid / TICK_SIZE_IN_CENTS)),
+                        mCompliance.Capacity(Subtrader::MARKET_MAKING, Side::BUY), numNewOrdersAllowed);
+    if (front.ask != 0)
+        ReconcileQuotes(Side::SELL, front.ask, numClones, mCompliance.Capacity(Subtrader::MARKET_MAKING, Side::SELL),
+                        numNewOrdersAllowed);
+
+    // Make sure a pass that could not do everything is not skipped next time
+    if (numNewOrdersAllowed == 0)
+        mMarketData.Invalidate();
+
+    IF_DBG {
+        unsigned long bidQuote = mOrders.Ladder(Side::BUY).Empty() ? 0 : mOrders.Ladder(Side::BUY).HighPrice();
+        unsigned long askQuote = mOrders.Ladder(Side::SELL).Empty() ? 0 : mOrders.Ladder(Side::SELL).LowPrice();
+        RLOG(LG_AT, LogLevel::LL_INFO) << "making market for ETF " << bidQuote << ":" << askQuote;
+    }
+    mTrader.Checkpoint();
+    latency.BookHandled();
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::OnOrderFilled(unsigned long clientOrderId, unsigned long price, unsigned long volume)
+{
+    if (ArbitrageOrder* arbitrage = mArbitrage.Find(clientOrderId)) {
+        // Already hedged when it was sent
+        volume = std::min(volume, arbitrage->remaining);
+        arbitrage->remaining -= volume;
+        mCompliance.OnFill(Subtrader::ARBITRAGE, arbitrage->side, volume);
+        IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "arbitrage order " << clientOrderId << " filled for " << volume
+                                              << " lots at $" << price << " cents";
+    } else if (Order* order = mOrders.Find(clientOrderId)) {
+        volume = std::min(volume, order->volume);
+        order->volume -= volume;
+        order->filled += volume;
+        mCompliance.OnFill(Subtrader::MARKET_MAKING, order->side, volume);
+        mHedges.OnFill(order->side, volume);
+        IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "order " << clientOrderId << " filled for " << volume
+                                       << " lots at $" << price << " cents";
+    } else {
+        IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << "unknown order " << clientOrderId << " was filled!";
+        return;
+    }
+
+    if (mCompliance.Breached())
+        Panic();
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::OnOrderStatus(unsigned long clientOrderId,
+                                              unsigned long fillVolume,
+                                              unsigned long remainingVolume)
 {
-    // Add new message and advance pointer
-    ptime currentTime = boost::posix_time::microsec_clock::universal_time();
-    *(mTail++) = currentTime;
-    mRollingMessageCount++;
-    if (mTail == mMem.end())
-        mTail = mMem.begin();
+    if (ArbitrageOrder* arbitrage = mArbitrage.Find(clientOrderId)) {
+        if (remainingVolume == 0) {
+            mCompliance.OnDone(Subtrader::ARBITRAGE, arbitrage->side, arbitrage->remaining);
+            FinishArbitrage(*arbitrage, fillVolume);
+        }
+        return;
+    }
 
-    // Remove timed out messages
-    while (mHead != mTail && currentTime - *mHead > MessageFrequencyTracker::PeriodLength) {
-        mRollingMessageCount--;
-        if (++mHead == mMem.end())
-            mHead = mMem.begin();
+    Order* order = mOrders.Find(clientOrderId);
+    if (order == nullptr) {
+        IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << "unknown order " << clientOrderId << " had an update!";
+        return;
     }
-    IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << " rolling message count " << mRollingMessageCount;
-
-    // Wait until submission is safe, this is a safety mechanism
-    // and should ideally never be used
-    if (mRollingMessageCount > MAX_MESSAGE_FREQ) {
-        time_duration wait_for = currentTime - *mHead + boost::posix_time::milliseconds(100);
-        IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << " before message submission waiting for " << wait_for;
-        boost::this_thread::sleep(wait_for);
+
+    if (remainingVolume == 0) {
+        // Leaves a hole in the ladder the next quoting pass has to fill
+        mCompliance.OnDone(Subtrader::MARKET_MAKING, order->side, order->volume);
+        mOrders.Release(order);
+        mMarketData.Invalidate();
+        return;
+    }
+
+    // Fills were taken off already, what is left went away with an amend
+    if (remainingVolume < order->volume)
+        mCompliance.Reduce(Subtrader::MARKET_MAKING, order->side, order->volume - remainingVolume);
+    order->volume = remainingVolume;
+    switch (order->state) {
+    case OrderState::PENDING_NEW:
+        order->state = OrderState::LIVE;
+        break;
+    case OrderState::PENDING_AMEND:
+        // The amend is through once the order is no bigger than it asked
+        if (fillVolume + remainingVolume <= order->amendVolume)
+            order->state = OrderState::LIVE;
+        break;
+    default:
+        // Fills while live or while a cancel is in flight
+        break;
     }
 }
 
-int MessageFrequencyTracker::GetNewOrdersAllowed()
+template <typename Pair, size_t INDEX>
+bool PairStrategy<Pair, INDEX>::FindArbitrage()
 {
-    // Remove timed out messages
-    ptime currentTime = boost::posix_time::microsec_clock::universal_time();
-    while (mHead != mTail && currentTime - *mHead > MessageFrequencyTracker::PeriodLength) {
-        mRollingMessageCount--;
-        if (++mHead == mMem.end())
-            mHead = mMem.begin();
+    const BookSnapshot& etf = mMarketData.Book(ETF);
+    const BookSnapshot& future = mMarketData.Book(FUT);
+    const long minEdge = mTrader.mParams.arbitrageMinEdge;
+    bool sent = false;
+
+    // ETF rich: sell it into its bids and buy the future
+    if (!mArbitrage.InFlight(Side::SELL)) {
+        ArbitrageOpportunity opportunity = ScanArbitrage<Side::SELL>(etf.bidPrices, etf.bidVolumes, future.askPrices,
+                                                                     future.askVolumes, minEdge);
+        sent |= SendArbitrage(Side::SELL, opportunity);
+    }
+
+    // ETF cheap: buy it from its asks and sell the future
+    if (!mArbitrage.InFlight(Side::BUY)) {
+        ArbitrageOpportunity opportunity = ScanArbitrage<Side::BUY>(etf.askPrices, etf.askVolumes, future.bidPrices,
+                                                                    future.bidVolumes, minEdge);
+        sent |= SendArbitrage(Side::BUY, opportunity);
     }
-    
-    // Figure out what message strategy is guaranteed to be compliant
-    constexpr unsigned long safetyMargin = 0;
-    constexpr unsigned long maxOpenOrders = 2 * NUM_CLONES;
-    unsigned long freeMessages = MAX_MESSAGE_FREQ - mRollingMessageCount;
-    return (int)std::max(0UL, (freeMessages - maxOpenOrders - safetyMargin) / 2);
+    return sent;
+}
+
+template <typename Pair, size_t INDEX>
+bool PairStrategy<Pair, INDEX>::SendArbitrage(Side side, const ArbitrageOpportunity& opportunity)
+{
+    // Room left next to our resting quotes, which the exchange counts
+    // against the position limit as well
+    long capacity = mCompliance.Capacity(Subtrader::ARBITRAGE, side);
+    unsigned long volume = std::min(opportunity.volume, (unsigned long)std::max(0L, capacity));
+    // The IOC, its hedge and possibly the unwind
+    if (volume == 0 || mCompliance.MessagesAllowed(Subtrader::ARBITRAGE) < 3)
+        return false;
+    if (!mCompliance.CanInsert(Subtrader::ARBITRAGE, side, volume)) {
+        IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << "arbitrage of " << volume << " lots at " << opportunity.price
+                                                 << " dropped, it would exceed the position allowance";
+        return false;
+    }
+
+    unsigned long orderId = mTrader.NextOrderId(INDEX);
+    mTrader.SendInsertOrder(orderId, side, opportunity.price, volume, Lifespan::FILL_AND_KILL);
+    mArbitrage.Track(orderId, side, volume);
+
+    // Hedge in the same breath instead of waiting for the fill
+    SendHedge(side == Side::SELL ? Side::BUY : Side::SELL, volume);
+    IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "arbitrage " << (side == Side::SELL ? "selling " : "buying ") << volume
+                                          << " lots at " << opportunity.price;
+    return true;
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::FinishArbitrage(ArbitrageOrder& order, unsigned long fillVolume)
+{
+    unsigned long unfilled = order.volume - std::min(fillVolume, order.volume);
+    if (unfilled != 0) {
+        // The hedge went the other way, undo it for what we did not get
+        SendHedge(order.side, unfilled);
+    }
+    mArbitrage.Release(&order);
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::SendHedge(Side side, unsigned long volume)
+{
+    if (!mCompliance.CanHedge()) {
+        IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << "hedge of " << volume << " lots held back, too many hedges in flight";
+        mHedges.Hold(side == Side::BUY ? (long)volume : -(long)volume);
+        return;
+    }
+    mTrader.SendHedgeOrder(mTrader.NextOrderId(INDEX), side,
+                           side == Side::BUY ? MAX_ASK_NEAREST_TICK : MIN_BID_NEAREST_TICK, volume);
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::Panic()
+{
+    RLOG(LG_AT, LogLevel::LL_ERROR) << "position limit breached on pair " << INDEX << ": ETF "
+                                    << mCompliance.EtfPosition() << ", future " << mCompliance.FuturePosition()
+                                    << ", pulling all quotes";
+    mOrders.ForEach(Side::BUY, [&](Order& order) { CancelOrder(order); });
+    mOrders.ForEach(Side::SELL, [&](Order& order) { CancelOrder(order); });
+    mMarketData.Invalidate();
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::ReconcileQuotes(Side side, unsigned long frontPrice, int numClones, long capacity,
+                                                int& messagesAllowed)
+{
+    // Target ladder: numClones levels of lotSize stepping away from frontPrice,
+    // filled from the front until the remaining position capacity runs out
+    const unsigned long lotSize = mTrader.mParams.lotSize;
+    const bool isBid = side == Side::BUY;
+    const unsigned long depth = (unsigned long)(numClones - 1) * TICK_SIZE_IN_CENTS;
+    const unsigned long backPrice = isBid ? frontPrice - depth : frontPrice + depth;
+    const unsigned long lowPrice = isBid ? backPrice : frontPrice;
+    const unsigned long highPrice = isBid ? frontPrice : backPrice;
+
+    // Orders off the target ladder only ever get cancelled. They still count
+    // towards the capacity, because they might be filled before the
+    // cancellation is effective
+    mOrders.ForEach(side, [&](Order& order) {
+        if (order.price < lowPrice || order.price > highPrice) {
+            CancelOrder(order);
+            capacity -= (long)order.volume;
+        }
+    });
+
+    // Every order resting on the ladder, cancelled or not, keeps its volume
+    // reserved until the exchange has taken it off
+    std::array<Order*, MAX_CLONES> orders{};
+    LadderVolumes resting{};
+    for (int offset = 0; offset < numClones; offset++) {
+        Order* order = mOrders.AtPrice(side, LevelPrice(side, frontPrice, offset));
+        orders[offset] = order;
+        resting[offset] = order == nullptr ? 0 : order->volume;
+    }
+    const LadderVolumes targets = CapVolumes(capacity, lotSize, numClones, resting);
+
+    // Walk the target levels from the front and emit the cheapest change for
+    // each: nothing, an amend down, or a cancel. Cancels and amends go out
+    // before any insert, so the exchange has taken their volume off first.
+    for (int offset = 0; offset < numClones; offset++) {
+        Order* order = orders[offset];
+        const unsigned long target = targets[offset];
+        if (order == nullptr || order->state == OrderState::PENDING_CANCEL)
+            continue;
+        // Amends can only reduce volume, the exchange keeps queue priority
+        unsigned long requested = order->state == OrderState::PENDING_AMEND
+                                  ? order->amendVolume - std::min(order->filled, order->amendVolume)
+                                  : order->volume;
+        if (target == 0) {
+            CancelOrder(*order);
+        } else if (target < requested && messagesAllowed > 0) {
+            AmendOrder(*order, target);
+            messagesAllowed--;
+        }
+    }
+
+    // Then an insert wherever there is no order yet
+    for (int offset = 0; offset < numClones; offset++) {
+        const unsigned long target = targets[offset];
+        if (orders[offset] != nullptr || target == 0 || messagesAllowed <= 0)
+            continue;
+        const unsigned long price = LevelPrice(side, frontPrice, offset);
+        if (!mCompliance.CanInsert(Subtrader::MARKET_MAKING, side, target)) {
+            IF_DBG_RLOG(LG_AT, LogLevel::LL_WARNING) << "quote of " << target << " lots at " << price
+                                                     << " dropped, it would exceed the position allowance";
+            continue;
+        }
+        if (mOrders.CanTrack(side, price)) {
+            unsigned long orderId = mTrader.NextOrderId(INDEX);
+            mTrader.SendInsertOrder(orderId, side, price, target, Lifespan::GOOD_FOR_DAY);
+            messagesAllowed--;
+            mOrders.Track(side, price, target, orderId);
+        }
+    }
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::AmendOrder(Order& order, unsigned long volume)
+{
+    // The exchange takes the new total, including what already traded
+    order.state = OrderState::PENDING_AMEND;
+    order.amendVolume = order.filled + volume;
+    mTrader.SendAmendOrder(order.orderId, order.amendVolume);
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::CancelOrder(Order& order)
+{
+    // The cancel is already on its way, the order goes away with its final status
+    if (order.state == OrderState::PENDING_CANCEL)
+        return;
+    order.state = OrderState::PENDING_CANCEL;
+    mTrader.SendCancelOrder(order.orderId);
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::OnTradeTicks(Instrument instrument,
+                                             unsigned long sequenceNumber,
+                                             const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
+                                             const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
+                                             const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
+                                             const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes)
+{
+    const Instrument role = Pair::Role(instrument);
+    if (!mMarketData.OnTradeTicks(role, sequenceNumber))
+        return;
+    mFlow.OnTradeTicks(role, askPrices, askVolumes, bidPrices, bidVolumes);
+    IF_DBG_RLOG(LG_AT, LogLevel::LL_INFO) << "trade ticks received for " << instrument << " instrument"
+                                   << ": ask prices: " << askPrices[0]
+                                   << "; ask volumes: " << askVolumes[0]
+                                   << "; bid prices: " << bidPrices[0]
+                                   << "; bid volumes: " << bidVolumes[0];
+}
+
+template <typename Pair, size_t INDEX>
+void PairStrategy<Pair, INDEX>::Withdrawn(unsigned long clientOrderId)
+{
+    // Called from inside CancelOrder, leave the order in place until the
+    // caller is done with it, as if its final status had arrived
+    boost::asio::post(mTrader.mContext, [this, clientOrderId] {
+        Order* order = mOrders.Find(clientOrderId);
+        if (order == nullptr)
+            return;
+        mCompliance.OnDone(Subtrader::MARKET_MAKING, order->side, order->volume);
+        mOrders.Release(order);
+        mMarketData.Invalidate();
+        mTrader.Checkpoint();
+    });
 }
@@ -19,64 +19,186 @@
 #define CPPREADY_TRADER_GO_AUTOTRADER_H
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <string>
-#include <unordered_set>
-#include <set>
+#include <tuple>
+#include <utility>
 
 #include <boost/asio/io_context.hpp>
-#include <boost/thread/thread.hpp> 
-#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/asio/signal_set.hpp>
 
 #include <ready_trader_go/baseautotrader.h>
 #include <ready_trader_go/logging.h>
 #include <ready_trader_go/types.h>
 
-struct Order {
-    Order(unsigned long price, unsigned long volume, unsigned long orderId) : price(price), volume(volume), orderId(orderId) {}
+#include "arbitrage.h"
+#include "checkpoint.h"
+#include "clock.h"
+#include "compliance.h"
+#include "constants.h"
+#include "debug.h"
+#include "flow.h"
+#include "hedge.h"
+#include "journal.h"
+#include "latency.h"
+#include "lowlatency.h"
+#include "marketdata.h"
+#include "ordertracker.h"
+#include "pairs.h"
+#include "parameters.h"
+#include "quotekernel.h"
+#include "throttle.h"
 
-    unsigned long price, volume, orderId;
-};
+class AutoTrader;
+
+// Quoting, arbitrage, hedging and risk of one instrument pair: its orders,
+// books, trade flow, positions and hedges. Each pair has an instance of its
+// own, cache line aligned so pairs never share one. What is per connection,
+// the message throttle, and the journal, latency probes and checkpoint
+// belong to the AutoTrader, which hands each event to its pair.
+template <typename Pair, size_t INDEX>
+class alignas(64) PairStrategy {
+public:
+    using Instruments = Pair;
+    static constexpr size_t PAIR_INDEX = INDEX;
+
+    explicit PairStrategy(AutoTrader& trader);
+
+    PairStrategy(const PairStrategy&) = delete;
+    PairStrategy& operator=(const PairStrategy&) = delete;
+
+    // Handlers for the events of this pair, called by the AutoTrader's
+    void OnOrderBook(ReadyTraderGo::Instrument instrument, unsigned long sequenceNumber,
+                     const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askPrices,
+                     const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askVolumes,
+                     const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidPrices,
+                     const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidVolumes, std::uint64_t arrived);
+    void OnTradeTicks(ReadyTraderGo::Instrument instrument, unsigned long sequenceNumber,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askPrices,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askVolumes,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidPrices,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidVolumes);
+    void OnOrderFilled(unsigned long clientOrderId, unsigned long price, unsigned long volume);
+    void OnOrderStatus(unsigned long clientOrderId, unsigned long fillVolume, unsigned long remainingVolume);
+    void OnHedgeFilled(unsigned long clientOrderId, unsigned long volume);
+    // Returns false unless the error was a rejected amend, which leaves the
+    // order resting; anything else ends the order
+    bool OnAmendRejected(unsigned long clientOrderId);
+    // An insert the throttle dropped because it was cancelled while queued
+    void Withdrawn(unsigned long clientOrderId);
+
+    // Takes over the state a previous process saved. Orders with ids below
+    // restoredBelow are the restored ones.
+    void Restore(const PairCheckpoint& state, unsigned long restoredBelow);
+    void Save(PairCheckpoint& state);
+
+    OrderTracker& Orders() { return mOrders; }
+    ComplianceLayer& Compliance() { return mCompliance; }
+    HedgeAggregator& Hedges() { return mHedges; }
+    const TradeFlowAnalytics& Flow() const { return mFlow; }
+    const MarketDataStats& MarketData() const { return mMarketData.Stats(); }
+
+private:
+    // Re-quotes from the latest future book, posted by the book handler and
+    // run once for all books that arrived before it. arrived is the TSC of
+    // the book that posted it, tick-to-trade is measured from there.
+    void QuotePass(std::uint64_t arrived);
 
-RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_AT, "AUTO")
+    // Arbitrage subtrader: takes fee-adjusted crosses between the ETF and
+    // future books of the same tick with an IOC on the ETF, hedged at once.
+    // Both return whether they sent anything.
+    bool FindArbitrage();
+    bool SendArbitrage(ReadyTraderGo::Side side, const ArbitrageOpportunity& opportunity);
 
-constexpr unsigned int LOT_SIZE = 10;
-constexpr int POSITION_LIMIT = 100;
-constexpr int TICK_SIZE_IN_CENTS = 100;
-constexpr int MIN_BID_NEAREST_TICK = (ReadyTraderGo::MINIMUM_BID + TICK_SIZE_IN_CENTS) / TICK_SIZE_IN_CENTS * TICK_SIZE_IN_CENTS;
-constexpr int MAX_ASK_NEAREST_TICK = ReadyTraderGo::MAXIMUM_ASK / TICK_SIZE_IN_CENTS * TICK_SIZE_IN_CENTS;
+    // Unwinds the hedge of the part of an arbitrage IOC that did not fill
+    void FinishArbitrage(ArbitrageOrder& order, unsigned long fillVolume);
 
-constexpr ReadyTraderGo::Instrument FUT = ReadyTraderGo::Instrument::FUTURE;
-constexpr ReadyTraderGo::Instrument ETF = ReadyTraderGo::Instrument::ETF;
-constexpr double TAKER_FEE = 0.0002;
-constexpr double MAKER_FEE = -0.0001;
+    // Sends a hedge on the future, or keeps it owed while the compliance
+    // layer cannot track another one
+    void SendHedge(ReadyTraderGo::Side side, unsigned long volume);
 
-constexpr int NUM_CLONES = 5;
-constexpr unsigned long ADDITIONAL_SPREAD = 1 * TICK_SIZE_IN_CENTS;
-constexpr size_t MAX_MESSAGE_FREQ = 50;
+    // Pulls every quote after a fill left a position beyond its limit
+    void Panic();
 
-using ptime = boost::posix_time::ptime;
-using time_duration = boost::posix_time::time_duration;
+    // Quote diff stage: brings one side of the live ladder in line with the
+    // target ladder of numClones levels starting at frontPrice, using as few
+    // messages as possible. capacity is the position room on this side,
+    // messagesAllowed the budget for inserts and amends shared by both sides.
+    void ReconcileQuotes(ReadyTraderGo::Side side, unsigned long frontPrice, int numClones, long capacity,
+                         int& messagesAllowed);
 
-class MessageFrequencyTracker {
-    using arr_type = std::array<ptime, 16 * MAX_MESSAGE_FREQ>;
-    arr_type mMem;
-    arr_type::iterator mHead, mTail;
-    unsigned long mRollingMessageCount;
-    static time_duration PeriodLength;
+    // Reduces what is left of an order to volume, keeping its queue priority
+    void AmendOrder(Order& order, unsigned long volume);
+
+    // Requests cancellation unless a cancel for this order is already in flight
+    void CancelOrder(Order& order);
+
+    // Cancels the restored orders and hedges back to flat, once the
+    // exchange is there to hear it, then drops restored orders whose
+    // cancel was never answered because they were gone already
+    void Reconcile();
+
+    AutoTrader& mTrader;
+    OrderTracker mOrders;
+    ArbitrageTracker mArbitrage;
+    MarketDataStage mMarketData;
+    TradeFlowAnalytics mFlow;
+    ComplianceLayer mCompliance;
+    HedgeAggregator mHedges;
+    unsigned long mRestoredBelow = 0;  // orders with lower ids came from the checkpoint
+    int mReconcileBooks = 0;
+};
+
+template <typename List, typename Indices>
+class PairStrategiesOf;
+
+// The strategies of all traded pairs, laid out one after the other. The
+// For* helpers unfold at compile time into one comparison per pair, with
+// a single pair they come down to a direct call.
+template <typename... Pairs, size_t... I>
+class PairStrategiesOf<PairList<Pairs...>, std::index_sequence<I...>> : public PairStrategy<Pairs, I>... {
 public:
-    MessageFrequencyTracker() : mMem{}, mRollingMessageCount(0) {
-        mHead = mMem.begin();
-        mTail = mMem.begin();
+    explicit PairStrategiesOf(AutoTrader& trader) : PairStrategy<Pairs, I>(trader)... {}
+
+    template <size_t J>
+    std::tuple_element_t<J, std::tuple<PairStrategy<Pairs, I>...>>& Get() { return *this; }
+    template <size_t J>
+    const std::tuple_element_t<J, std::tuple<PairStrategy<Pairs, I>...>>& Get() const { return *this; }
+
+    template <typename F>
+    void ForEach(F&& f) { ((void)f(static_cast<PairStrategy<Pairs, I>&>(*this)), ...); }
+
+    // The pair an order, hedge or error is for
+    template <typename F>
+    void ForOrder(unsigned long orderId, F&& f) {
+        const size_t pair = PairOfOrder(orderId);
+        ((pair == I ? (void)f(static_cast<PairStrategy<Pairs, I>&>(*this)) : void()), ...);
+    }
+
+    // The pair a book or trade ticks message is for
+    template <typename F>
+    void ForInstrument(ReadyTraderGo::Instrument instrument, F&& f) {
+        ((Pairs::Contains(instrument) ? (void)f(static_cast<PairStrategy<Pairs, I>&>(*this)) : void()), ...);
     }
-    void NoteMessage();
-    int GetNewOrdersAllowed();
 };
 
-class AutoTrader : public ReadyTraderGo::BaseAutoTrader
+using PairStrategies = PairStrategiesOf<TradedPairs, std::make_index_sequence<TradedPairs::COUNT>>;
+
+class AutoTrader final : public ReadyTraderGo::BaseAutoTrader
 {
 public:
-    explicit AutoTrader(boost::asio::io_context& context);
+    // All time measurements go through clock, offline simulations pass a
+    // SimulatedClock here. params must be Valid(). If AUTOTRADER_LOW_LATENCY
+    // is set, the calling thread, which is expected to run context, is
+    // pinned, locked and warmed up before this returns (see lowlatency.h).
+    // If AUTOTRADER_CHECKPOINT names a file, the state is kept there and a
+    // trader restarted on the same file carries on from it. Both only apply
+    // to a trader on the system clock.
+    explicit AutoTrader(boost::asio::io_context& context,
+                        const Clock& clock = Clock::System(),
+                        const StrategyParameters& params = StrategyParameters());
 
     // Called when the execution connection is lost.
     void DisconnectHandler() override;
@@ -138,22 +260,92 @@ public:
                                   const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidPrices,
                                   const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidVolumes) override;
 
-    // Overrides for message frequency tracking
+    // Overrides routing every outbound message through the throttle. Each
+    // message is charged to a subtrader of the order's pair: hedges to
+    // HEDGE, FAK inserts to ARBITRAGE and everything else to MARKET_MAKING.
     void SendAmendOrder(unsigned long clientOrderId, unsigned long volume) override;
     void SendCancelOrder(unsigned long clientOrderId) override;
     void SendHedgeOrder(unsigned long clientOrderId, ReadyTraderGo::Side side, unsigned long price, unsigned long volume) override;
     void SendInsertOrder(unsigned long clientOrderId, ReadyTraderGo::Side side, unsigned long price, unsigned long volume, ReadyTraderGo::Lifespan lifespan) override;
 
+    // Binary journal of every handler call and every message actually sent.
+    // Opened by the constructor of a trader on the system clock if the
+    // AUTOTRADER_JOURNAL environment variable names a file, offline tools
+    // may open it themselves.
+    EventJournal& Journal() { return mJournal; }
+
+    // Outbound throttle statistics, e.g. queue depth and time spent queued
+    const MessageThrottle& Throttle() const { return mThrottle; }
+    MessageThrottle& Throttle() { return mThrottle; }
+
+    // The strategy of one traded pair, the first by default
+    template <size_t PAIR = 0>
+    auto& Pair() { return mPairs.template Get<PAIR>(); }
+
+    // Nets the hedges of market making fills of a pair
+    template <size_t PAIR = 0>
+    HedgeAggregator& Hedges() { return Pair<PAIR>().Hedges(); }
+
+    // Rolling VWAP, imbalance, volatility and arrival rate of a pair's trade ticks
+    template <size_t PAIR = 0>
+    const TradeFlowAnalytics& Flow() { return Pair<PAIR>().Flow(); }
+
+    // Stale, gapped and conflated market data and skipped quoting passes of a pair
+    template <size_t PAIR = 0>
+    const MarketDataStats& MarketData() { return Pair<PAIR>().MarketData(); }
+
+    // When the first open hedge window of any pair closes, and sends the
+    // hedges of all windows that are due. Lets simulations that do not run
+    // the io_context drive the windows.
+    ptime NextHedgeFlush();
+    void FlushHedgesIfDue();
+
+    // Per-handler and tick-to-trade latency histograms. They are dumped to
+    // stderr when the execution connection is lost or on SIGUSR1.
+    const LatencyRecorder& Latency() const { return mLatency; }
+
 private:
+    template <typename Pair, size_t INDEX>
+    friend class PairStrategy;
+
+    // A dry run trader handles everything as usual but sends nothing and
+    // reads no environment, it is used for the warm-up
+    AutoTrader(boost::asio::io_context& context, const Clock& clock, const StrategyParameters& params, bool dryRun);
+
+    // Runs synthetic books, trade ticks, acknowledgements, fills and hedges
+    // through a dry run trader, so code, branch predictors and allocator
+    // are warm when the first real book arrives
+    void WarmUp(int rounds);
+
+    // Next client order id for an order of the given pair
+    unsigned long NextOrderId(size_t pair) { return OrderIdFor(mNextMessageId++, pair); }
+
+    // Takes over the ids and the state of every pair a previous process
+    // left in the checkpoint
+    void Restore(const CheckpointState& state);
+    // Writes the current state to the checkpoint, if there is one
+    void Checkpoint();
+
+    // Dumps the latency histograms whenever SIGUSR1 arrives
+    void WaitForDumpSignal();
+
+    // Journals and sends a message the throttle let through, right away or
+    // after it was queued
+    void Dispatch(const OutboundMessage& message);
+
+    const StrategyParameters mParams;
+    const bool mDryRun;
+    const Clock& mClock;
+    const SkewTable mSkew;
     unsigned long mNextMessageId = 1;
-    signed long mPosition = 0;
-    std::set<unsigned long> mBidPrices;
-    std::set<unsigned long> mAskPrices;
-    std::unordered_map<unsigned long, Order*> mBidToOrder;
-    std::unordered_map<unsigned long, Order*> mBidOrderIdToOrder;
-    std::unordered_map<unsigned long, Order*> mAskToOrder;
-    std::unordered_map<unsigned long, Order*> mAskOrderIdToOrder;
-    MessageFrequencyTracker mMessageTracker;
+    std::int64_t mSessionStart;  // event time the first trader of the session started
+    EventJournal mJournal;
+    MessageThrottle mThrottle;
+    LatencyRecorder mLatency;
+    PairStrategies mPairs;
+    boost::asio::signal_set mDumpSignal;
+    LowLatencyRuntime mRuntime;
+    StateCheckpoint mCheckpoint;
 };
 
 #endif //CPPREADY_TRADER_GO_AUTOTRADER_H
@@ -0,0 +1,133 @@
+#ifndef CPPREADY_TRADER_GO_CHECKPOINT_H
+#define CPPREADY_TRADER_GO_CHECKPOINT_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "clock.h"
+#include "compliance.h"
+#include "constants.h"
+#include "ordertracker.h"
+#include "pairs.h"
+
+static_assert(std::is_trivially_copyable_v<Order>, "orders are copied into the checkpoint as they are");
+
+// Positions and resting orders of one traded pair
+struct PairCheckpoint {
+    std::array<long, (size_t)Subtrader::COUNT> positions;
+    long futurePosition;
+    long hedgesInFlight;  // future lots of hedges sent but not answered yet
+    std::uint32_t orderCount;
+    std::array<Order, MAX_TRACKED_ORDERS> orders;
+};
+
+// Everything a restarted trader needs to carry on where the last one
+// stopped: the ids it used and the state of every pair
+struct CheckpointState {
+    std::uint64_t generation;
+    std::int64_t sessionStart;  // event time the first trader of the session started
+    std::int64_t written;       // event time of this state
+    unsigned long nextMessageId;
+    std::array<PairCheckpoint, TradedPairs::COUNT> pairs;
+};
+
+// Trader state kept in a memory-mapped file, written in place after every
+// handler that changed it. There are two copies: the trader fills the one
+// not in use and then flips the header's index to it, so whatever moment
+// the process dies at, the file holds a complete state. Writing involves
+// no system calls; the pages survive a crash of the process in the page
+// cache, like the journal's. The layout is specific to the build, a file
+// of another layout is ignored.
+class StateCheckpoint {
+public:
+    static constexpr std::uint64_t MAGIC = 0x5254474f43484b50ULL;  // "RTGOCHKP"
+    static constexpr std::uint32_t VERSION = 5;
+    // Ready Trader Go sessions run for 15 minutes
+    static constexpr long SESSION_SECONDS = 15 * 60;
+
+    StateCheckpoint() = default;
+    ~StateCheckpoint() { Close(); }
+
+    StateCheckpoint(const StateCheckpoint&) = delete;
+    StateCheckpoint& operator=(const StateCheckpoint&) = delete;
+
+    // Maps path, creating it if needed, and keeps what it holds for Last.
+    // Returns false if it cannot be mapped, the checkpoint then stays closed.
+    bool Open(const std::string& path) {
+        Close();
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return false;
+        struct stat info{};
+        const bool fresh = ::fstat(fd, &info) != 0 || (size_t)info.st_size != sizeof(File);
+        void* map = !fresh || ::ftruncate(fd, sizeof(File)) == 0
+                    ? ::mmap(nullptr, sizeof(File), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0)
+                    : MAP_FAILED;
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return false;
+
+        mFile = static_cast<File*>(map);
+        if (fresh || mFile->magic != MAGIC || mFile->version != VERSION || mFile->size != sizeof(File)) {
+            *mFile = File{};
+            mFile->magic = MAGIC;
+            mFile->version = VERSION;
+            mFile->size = sizeof(File);
+        }
+        mGeneration = mFile->states[mFile->active].generation;
+        return true;
+    }
+
+    void Close() {
+        if (mFile == nullptr)
+            return;
+        ::msync(mFile, sizeof(File), MS_SYNC);
+        ::munmap(mFile, sizeof(File));
+        mFile = nullptr;
+    }
+
+    bool IsOpen() const { return mFile != nullptr; }
+
+    // State the previous process left behind, or nullptr if there is none.
+    // State written after now, or by a session that started more than a
+    // session ago, belongs to an earlier session and is stale.
+    const CheckpointState* Last(ptime now) const {
+        if (mFile == nullptr)
+            return nullptr;
+        const CheckpointState& state = mFile->states[__atomic_load_n(&mFile->active, __ATOMIC_ACQUIRE)];
+        const std::int64_t time = ToEventTime(now);
+        if (state.generation == 0 || state.written > time || time - state.sessionStart > SESSION_SECONDS * 1000000L)
+            return nullptr;
+        return &state;
+    }
+
+    // The copy to fill, publish it with Commit
+    CheckpointState& Begin() { return mFile->states[mFile->active ^ 1]; }
+
+    void Commit() {
+        CheckpointState& state = mFile->states[mFile->active ^ 1];
+        state.generation = ++mGeneration;
+        __atomic_store_n(&mFile->active, mFile->active ^ 1, __ATOMIC_RELEASE);
+    }
+
+private:
+    struct File {
+        std::uint64_t magic;
+        std::uint32_t version;
+        std::uint32_t active;  // index of the complete state
+        std::uint64_t size;
+        std::array<CheckpointState, 2> states;
+    };
+
+    File* mFile = nullptr;
+    std::uint64_t mGeneration = 0;
+};
+
+#endif //CPPREADY_TRADER_GO_CHECKPOINT_H
@@ -0,0 +1,48 @@
+#ifndef CPPREADY_TRADER_GO_CLOCK_H
+#define CPPREADY_TRADER_GO_CLOCK_H
+
+#include <cstdint>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using ptime = boost::posix_time::ptime;
+using time_duration = boost::posix_time::time_duration;
+
+// Source of time for everything that measures it. Live trading uses the
+// system clock, offline replays install a SimulatedClock so runs are
+// deterministic and not bound to real time.
+class Clock {
+public:
+    virtual ~Clock() = default;
+    virtual ptime Now() const { return boost::posix_time::microsec_clock::universal_time(); }
+
+    static const Clock& System() {
+        static const Clock clock;
+        return clock;
+    }
+};
+
+class SimulatedClock : public Clock {
+public:
+    explicit SimulatedClock(ptime start = ptime(boost::gregorian::date(2023, 1, 1))) : mNow(start) {}
+
+    ptime Now() const override { return mNow; }
+    void Set(ptime now) { mNow = now; }
+    void Advance(time_duration by) { mNow += by; }
+
+private:
+    ptime mNow;
+};
+
+// Timestamps in recorded events are microseconds since the epoch
+inline ptime FromEventTime(std::int64_t timestamp) {
+    static const ptime epoch(boost::gregorian::date(1970, 1, 1));
+    return epoch + boost::posix_time::microseconds(timestamp);
+}
+
+inline std::int64_t ToEventTime(ptime time) {
+    static const ptime epoch(boost::gregorian::date(1970, 1, 1));
+    return (time - epoch).total_microseconds();
+}
+
+#endif //CPPREADY_TRADER_GO_CLOCK_H
@@ -0,0 +1,38 @@
+# Profile-guided, link-time optimised release build of the autotrader.
+#   1. builds simulate_autotrader instrumented, against the stub library
+#   2. runs it over every line of replay/pgo_workload.txt
+#   3. rebuilds autotrader like compile_release.sh, with that profile and LTO
+# GCC names a profile after its object file. autotrader.cc is instrumented
+# under the object path the CMake build gives it, and both builds strip
+# their build directory from the name, so the final build finds the
+# profile. Functions that differ between the stub and the real library,
+# and the library itself, are optimised without a profile.
+set -e
+ROOT=$PWD
+PROFILE=$ROOT/build/pgo-profile
+GEN=$ROOT/build/pgo-generate
+rm -rf "$PROFILE" "$GEN"
+mkdir -p "$GEN/CMakeFiles/autotrader.dir"
+
+# Same optimisation level as CMake's Release, so the control flow matches
+CXXFLAGS="-std=c++17 -O3 -DNDEBUG -Wall -I$ROOT/replay/stub -I$ROOT -I$ROOT/replay"
+PROFILE_FLAGS="-fprofile-generate=$PROFILE -fprofile-prefix-path=$GEN -fprofile-update=single"
+(
+    cd "$GEN"
+    g++ $CXXFLAGS $PROFILE_FLAGS -c "$ROOT/autotrader.cc" -o CMakeFiles/autotrader.dir/autotrader.cc.o
+    g++ $CXXFLAGS -c "$ROOT/replay/simulate.cc" -o simulate.o
+    g++ $PROFILE_FLAGS CMakeFiles/autotrader.dir/autotrader.cc.o simulate.o -o simulate -lpthread
+)
+
+grep -v -e '^#' -e '^$' replay/pgo_workload.txt | while read -r args; do
+    echo "training: simulate $args"
+    "$GEN/simulate" $args > /dev/null
+done
+
+rm -f ./build/autotrader
+rm -f ./build/CMakeCache.txt
+cmake -DCMAKE_BUILD_TYPE=Release -DCMAKE_INTERPROCEDURAL_OPTIMIZATION=ON \
+      -DCMAKE_CXX_FLAGS="-fprofile-use=$PROFILE -fprofile-prefix-path=$ROOT/build -fprofile-partial-training -Wno-error=coverage-mismatch -Wno-missing-profile" \
+      -B build
+cmake --build build --config Release
+cp ./build/autotrader ./autotrader
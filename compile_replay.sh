@@ -0,0 +1,19 @@
+# Builds the offline tools. AutoTrader is compiled against the stub
+# BaseAutoTrader in replay/stub instead of the Ready Trader Go library.
+#   replay_autotrader   replays a recorded session open loop
+#   simulate_autotrader runs the trader closed loop against a local exchange
+#   sweep_autotrader    ranks strategy parameter sets over many simulations
+#   decode_autotrader   prints an event file or journal as text or CSV
+#   bench_autotrader    times the hot handlers on synthetic books
+mkdir -p build
+CXXFLAGS="-std=c++17 -O2 -Wall -I./replay/stub -I. -I./replay"
+g++ $CXXFLAGS autotrader.cc replay/replay.cc -o ./build/replay -lpthread
+g++ $CXXFLAGS autotrader.cc replay/simulate.cc -o ./build/simulate -lpthread
+g++ $CXXFLAGS autotrader.cc replay/sweep.cc -o ./build/sweep -lpthread
+g++ $CXXFLAGS replay/decode.cc -o ./build/decode
+g++ $CXXFLAGS autotrader.cc replay/bench.cc -o ./build/bench -lpthread
+cp ./build/replay ./replay_autotrader
+cp ./build/simulate ./simulate_autotrader
+cp ./build/sweep ./sweep_autotrader
+cp ./build/decode ./decode_autotrader
+cp ./build/bench ./bench_autotrader
@@ -0,0 +1,217 @@
+#ifndef CPPREADY_TRADER_GO_COMPLIANCE_H
+#define CPPREADY_TRADER_GO_COMPLIANCE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include <ready_trader_go/types.h>
+
+#include "clock.h"
+#include "constants.h"
+#include "throttle.h"
+
+// Strategies sharing the trader's limits, highest priority first
+enum class Subtrader : std::uint8_t {
+    HEDGE,          // risk reducing, never held back
+    ARBITRAGE,
+    MARKET_MAKING,
+    COUNT
+};
+
+inline const char* SubtraderName(Subtrader subtrader) {
+    static constexpr const char* names[] = {"HEDGE", "ARBITRAGE", "MARKET_MAKING"};
+    return names[(size_t)subtrader];
+}
+
+struct SubtraderBudget {
+    long positionAllowance;  // worst-case net ETF position its own orders may lead to, in lots
+    long messageReserve;     // messages per rolling window lower priorities cannot take
+    long messageLimit;       // messages per rolling window it may use at most
+};
+
+using ComplianceBudgets = std::array<SubtraderBudget, (size_t)Subtrader::COUNT>;
+
+// Hedges keep room for a hedge and its unwind, arbitrage for one round of
+// IOC, hedge and unwind but no more than a few, market making takes the rest.
+// Market making may use the whole position limit, its quotes earn almost
+// all of the PnL; arbitrage only adds while the net position is within 60.
+constexpr ComplianceBudgets DEFAULT_BUDGETS = {{
+    {POSITION_LIMIT, 6, (long)MAX_MESSAGE_FREQ},
+    {60, 3, 15},
+    {POSITION_LIMIT, 0, (long)MAX_MESSAGE_FREQ},
+}};
+
+// DEFAULT_BUDGETS with another position allowance for market making
+constexpr ComplianceBudgets WithMakingAllowance(long allowance) {
+    ComplianceBudgets budgets = DEFAULT_BUDGETS;
+    budgets[(size_t)Subtrader::MARKET_MAKING].positionAllowance = allowance;
+    return budgets;
+}
+
+// Pre-trade risk checks shared by all subtraders. Every check is O(1): the
+// layer keeps running totals of each subtrader's position, open volume per
+// side and open order count, updated from the order lifecycle, and a
+// rolling message count per subtrader next to the throttle's global one.
+//
+// Position: an ETF insert passes if, with every open order on its side
+// filled, both the subtrader's allowance and POSITION_LIMIT hold, the
+// latter being exactly what the exchange checks against the total. Both
+// apply to the net position of all subtraders: positions are hedged and
+// skewed as one, so a subtrader long what another is short carries no
+// risk and must not be held back for it. The per-subtrader positions are
+// kept for attribution only.
+//
+// Messages: one message per open order is always held back for its
+// cancel. Beyond that, a subtrader may use what the rolling window has
+// left, minus the unused reserves of higher priority subtraders, up to its
+// own limit. A new strategy therefore cannot starve a more important one,
+// and its limit keeps it from starving a less important one.
+class ComplianceLayer {
+public:
+    ComplianceLayer(const Clock& clock, MessageThrottle& throttle, const ComplianceBudgets& budgets = DEFAULT_BUDGETS)
+        : mClock(clock), mThrottle(throttle), mBudgets(budgets) {}
+
+    // Messages the subtrader may send right now
+    long MessagesAllowed(Subtrader subtrader) {
+        ptime now = mClock.Now();
+        long held = mOpenOrders;
+        for (size_t i = 0; i < (size_t)subtrader; i++)
+            held += std::max(0L, mBudgets[i].messageReserve - Used((Subtrader)i, now));
+        long own = mBudgets[(size_t)subtrader].messageLimit - Used(subtrader, now);
+        return std::max(0L, std::min(own, mThrottle.FreeMessages() - held));
+    }
+
+    // Inserts the subtrader may send right now, each needs room for its cancel
+    int NewOrdersAllowed(Subtrader subtrader) { return (int)(MessagesAllowed(subtrader) / 2); }
+
+    void NoteMessage(Subtrader subtrader) { mMessages[(size_t)subtrader].NoteMessage(mClock.Now()); }
+
+    // Volume the subtrader may have open on one side on top of its position
+    long Capacity(Subtrader subtrader, ReadyTraderGo::Side side) const {
+        const size_t s = (size_t)subtrader, i = SideIndex(side);
+        long own = mBudgets[s].positionAllowance - Signed(mTotalPosition, side) - mOpenVolume[s][i];
+        long total = POSITION_LIMIT - Signed(mTotalPosition, side) - mTotalOpenVolume[i];
+        return std::min(own, total) + mOpenVolume[s][i];
+    }
+
+    bool CanInsert(Subtrader subtrader, ReadyTraderGo::Side side, unsigned long volume) const {
+        return (long)volume <= Capacity(subtrader, side) - mOpenVolume[(size_t)subtrader][SideIndex(side)];
+    }
+
+    // ETF order lifecycle
+
+    void OnInsert(Subtrader subtrader, ReadyTraderGo::Side side, unsigned long volume) {
+        mOpenVolume[(size_t)subtrader][SideIndex(side)] += (long)volume;
+        mTotalOpenVolume[SideIndex(side)] += (long)volume;
+        mOpenOrders++;
+    }
+
+    void OnFill(Subtrader subtrader, ReadyTraderGo::Side side, unsigned long volume) {
+        Reduce(subtrader, side, volume);
+        long signedVolume = Signed((long)volume, side);
+        mPosition[(size_t)subtrader] += signedVolume;
+        mTotalPosition += signedVolume;
+    }
+
+    // Open volume that went away without trading, e.g. an acknowledged amend
+    void Reduce(Subtrader subtrader, ReadyTraderGo::Side side, unsigned long volume) {
+        mOpenVolume[(size_t)subtrader][SideIndex(side)] -= (long)volume;
+        mTotalOpenVolume[SideIndex(side)] -= (long)volume;
+    }
+
+    void OnDone(Subtrader subtrader, ReadyTraderGo::Side side, unsigned long unfilled) {
+        Reduce(subtrader, side, unfilled);
+        mOpenOrders--;
+    }
+
+    // Future hedges, filled or killed in the order they were sent
+
+    // Whether another hedge can be tracked until it is answered. A hedge
+    // that cannot be tracked must not be sent.
+    bool CanHedge() const { return mPendingHedgeCount < mPendingHedges.size(); }
+
+    void OnHedge(unsigned long orderId, ReadyTraderGo::Side side, unsigned long volume) {
+        mPendingHedges[(mPendingHedgeHead + mPendingHedgeCount++) % mPendingHedges.size()] =
+            PendingHedge{orderId, Signed((long)volume, side)};
+        mHedgesInFlight += Signed((long)volume, side);
+    }
+
+    // Returns the future lots the hedge, and any sent before it that were
+    // never answered, did not get, signed like their side
+    long OnHedgeFilled(unsigned long orderId, unsigned long volume) {
+        long shortfall = 0;
+        for (size_t n = 0; n < mPendingHedgeCount; n++) {
+            PendingHedge& hedge = mPendingHedges[(mPendingHedgeHead + n) % mPendingHedges.size()];
+            if (hedge.orderId != orderId) {
+                shortfall += hedge.signedVolume;
+                continue;
+            }
+            long filled = hedge.signedVolume < 0 ? -(long)volume : (long)volume;
+            mFuturePosition += filled;
+            mHedgesInFlight -= shortfall + hedge.signedVolume;
+            // Only the head is normally answered, anything before it was lost
+            mPendingHedgeHead = (mPendingHedgeHead + n + 1) % mPendingHedges.size();
+            mPendingHedgeCount -= n + 1;
+            return shortfall + hedge.signedVolume - filled;
+        }
+        return 0;
+    }
+
+    // Positions a previous process left behind. Open orders are added back
+    // with OnInsert. Hedges that were in flight are not tracked again, the
+    // caller folds them into futurePosition as if they had filled.
+    void Restore(const std::array<long, (size_t)Subtrader::COUNT>& positions, long futurePosition) {
+        mPosition = positions;
+        mTotalPosition = 0;
+        for (long position : positions)
+            mTotalPosition += position;
+        mFuturePosition = futurePosition;
+    }
+
+    // Whether a position is already beyond what it may be, the trader must
+    // then pull its orders. Allowances only hold subtraders back from adding.
+    bool Breached() const {
+        return std::abs(mTotalPosition) > POSITION_LIMIT || std::abs(mFuturePosition) > POSITION_LIMIT;
+    }
+
+    long Position(Subtrader subtrader) const { return mPosition[(size_t)subtrader]; }
+    long EtfPosition() const { return mTotalPosition; }
+    long FuturePosition() const { return mFuturePosition; }
+    // Future lots of hedges sent but not answered yet
+    long HedgesInFlight() const { return mHedgesInFlight; }
+    long OpenOrders() const { return mOpenOrders; }
+
+private:
+    struct PendingHedge {
+        unsigned long orderId;
+        long signedVolume;
+    };
+
+    static size_t SideIndex(ReadyTraderGo::Side side) { return side == ReadyTraderGo::Side::BUY ? 0 : 1; }
+    static long Signed(long value, ReadyTraderGo::Side side) { return side == ReadyTraderGo::Side::BUY ? value : -value; }
+
+    long Used(Subtrader subtrader, ptime now) {
+        return (long)MAX_MESSAGE_FREQ - mMessages[(size_t)subtrader].FreeMessages(now);
+    }
+
+    const Clock& mClock;
+    MessageThrottle& mThrottle;
+    const ComplianceBudgets mBudgets;
+    std::array<MessageFrequencyTracker, (size_t)Subtrader::COUNT> mMessages;
+
+    std::array<long, (size_t)Subtrader::COUNT> mPosition{};
+    std::array<std::array<long, 2>, (size_t)Subtrader::COUNT> mOpenVolume{};
+    std::array<long, 2> mTotalOpenVolume{};
+    long mTotalPosition = 0;
+    long mOpenOrders = 0;
+
+    std::array<PendingHedge, 64> mPendingHedges{};
+    size_t mPendingHedgeHead = 0, mPendingHedgeCount = 0;
+    long mFuturePosition = 0;
+    long mHedgesInFlight = 0;
+};
+
+#endif //CPPREADY_TRADER_GO_COMPLIANCE_H
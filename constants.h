@@ -0,0 +1,29 @@
+#ifndef CPPREADY_TRADER_GO_CONSTANTS_H
+#define CPPREADY_TRADER_GO_CONSTANTS_H
+
+#include <cstddef>
+
+#include <ready_trader_go/types.h>
+
+constexpr unsigned int LOT_SIZE = 10;
+constexpr int POSITION_LIMIT = 100;
+constexpr int TICK_SIZE_IN_CENTS = 100;
+constexpr int MIN_BID_NEAREST_TICK = (ReadyTraderGo::MINIMUM_BID + TICK_SIZE_IN_CENTS) / TICK_SIZE_IN_CENTS * TICK_SIZE_IN_CENTS;
+constexpr int MAX_ASK_NEAREST_TICK = ReadyTraderGo::MAXIMUM_ASK / TICK_SIZE_IN_CENTS * TICK_SIZE_IN_CENTS;
+
+constexpr ReadyTraderGo::Instrument FUT = ReadyTraderGo::Instrument::FUTURE;
+constexpr ReadyTraderGo::Instrument ETF = ReadyTraderGo::Instrument::ETF;
+constexpr double TAKER_FEE = 0.0002;
+constexpr double MAKER_FEE = -0.0001;
+
+constexpr int NUM_CLONES = 5;
+constexpr unsigned long ADDITIONAL_SPREAD = 1 * TICK_SIZE_IN_CENTS;
+constexpr size_t MAX_MESSAGE_FREQ = 50;
+
+// Order tracking capacity. Per side at most 2 * POSITION_LIMIT lots can be
+// resting (live plus cancels in flight), so 64 slots is ample headroom.
+constexpr size_t MAX_TRACKED_ORDERS = 64;
+// Width of the tick window one side of the ladder may span at any time
+constexpr unsigned long LADDER_TICKS = 64;
+
+#endif //CPPREADY_TRADER_GO_CONSTANTS_H
@@ -0,0 +1,20 @@
+#ifndef CPPREADY_TRADER_GO_DEBUG_H
+#define CPPREADY_TRADER_GO_DEBUG_H
+
+#include <iostream>
+
+#include <ready_trader_go/logging.h>
+
+#define RELEASE
+
+#ifdef RELEASE
+#define IF_DBG if (false)
+#define IF_DBG_RLOG(loggerName,logLevel) IF_DBG std::cout
+#else
+#define IF_DBG if (true)
+#define IF_DBG_RLOG(loggerName,logLevel) RLOG(loggerName,logLevel)
+#endif
+
+RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(LG_AT, "AUTO")
+
+#endif //CPPREADY_TRADER_GO_DEBUG_H
@@ -0,0 +1,147 @@
+#ifndef CPPREADY_TRADER_GO_EVENTRECORD_H
+#define CPPREADY_TRADER_GO_EVENTRECORD_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <ready_trader_go/types.h>
+
+// Everything that crosses the boundary between AutoTrader and the exchange,
+// in a fixed size binary record. Recorded sessions, the event journal and
+// the replay tooling all share this format.
+enum class EventType : std::uint8_t {
+    // Inbound, one per BaseAutoTrader handler
+    DISCONNECT,
+    ERROR,
+    HEDGE_FILLED,
+    ORDER_BOOK,
+    ORDER_FILLED,
+    ORDER_STATUS,
+    TRADE_TICKS,
+    // Outbound, one per Send* call
+    SEND_AMEND,
+    SEND_CANCEL,
+    SEND_HEDGE,
+    SEND_INSERT,
+};
+
+inline bool IsInbound(EventType type) { return type < EventType::SEND_AMEND; }
+
+inline const char* EventTypeName(EventType type) {
+    static constexpr const char* names[] = {"DISCONNECT", "ERROR", "HEDGE_FILLED", "ORDER_BOOK", "ORDER_FILLED",
+                                            "ORDER_STATUS", "TRADE_TICKS", "SEND_AMEND", "SEND_CANCEL",
+                                            "SEND_HEDGE", "SEND_INSERT"};
+    return (size_t)type < sizeof(names) / sizeof(names[0]) ? names[(size_t)type] : "UNKNOWN";
+}
+
+struct alignas(64) EventRecord {
+    static constexpr size_t LEVELS = ReadyTraderGo::TOP_LEVEL_COUNT;
+    static constexpr size_t TEXT_LENGTH = 4 * LEVELS * sizeof(std::uint32_t);
+
+    std::uint64_t sequence;   // position in the stream
+    std::int64_t timestamp;   // microseconds since the epoch
+    EventType type;
+    std::uint8_t instrument;  // ORDER_BOOK, TRADE_TICKS
+    std::uint8_t side;        // SEND_HEDGE, SEND_INSERT
+    std::uint8_t lifespan;    // SEND_INSERT
+    std::uint32_t reserved;
+    std::uint64_t id;         // sequence number for books and ticks, client order id otherwise
+
+    // ORDER_STATUS stores fill volume in price and remaining volume in volume
+    struct OrderFields {
+        std::uint64_t price, volume;
+        std::int64_t fees;
+    };
+    struct BookFields {
+        std::array<std::uint32_t, LEVELS> askPrices, askVolumes, bidPrices, bidVolumes;
+    };
+    union {
+        OrderFields order;
+        BookFields book;
+        char text[TEXT_LENGTH];  // ERROR, truncated and nul terminated
+    };
+};
+
+static_assert(sizeof(EventRecord) == 128, "records are two cache lines");
+
+// A file is this header followed by capacity records. Writers that wrap
+// around (the journal) keep appending at written % capacity, so the oldest
+// record still present is at written % capacity once written > capacity.
+struct alignas(64) EventFileHeader {
+    static constexpr char MAGIC[8] = {'R', 'T', 'G', 'E', 'V', 'T', '1', '\0'};
+
+    char magic[8];
+    std::uint32_t recordSize;
+    std::uint32_t reserved;
+    std::uint64_t capacity;
+    std::uint64_t written;
+
+    void Init(std::uint64_t slots) {
+        std::memcpy(magic, MAGIC, sizeof(magic));
+        recordSize = sizeof(EventRecord);
+        reserved = 0;
+        capacity = slots;
+        written = 0;
+    }
+
+    bool Valid() const {
+        return std::memcmp(magic, MAGIC, sizeof(magic)) == 0 && recordSize == sizeof(EventRecord) && capacity != 0;
+    }
+};
+
+static_assert(sizeof(EventFileHeader) == 64, "header occupies one cache line");
+
+template<typename Array>
+inline void PackLevels(std::array<std::uint32_t, EventRecord::LEVELS>& out, const Array& in) {
+    for (size_t i = 0; i < EventRecord::LEVELS; i++)
+        out[i] = (std::uint32_t)in[i];
+}
+
+template<typename Array>
+inline void UnpackLevels(Array& out, const std::array<std::uint32_t, EventRecord::LEVELS>& in) {
+    for (size_t i = 0; i < EventRecord::LEVELS; i++)
+        out[i] = in[i];
+}
+
+// Reads all records of a file in stream order. Returns false if the file
+// cannot be opened or is not an event file.
+inline bool ReadEventFile(const std::string& path, std::vector<EventRecord>& records) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    EventFileHeader header;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 && header.Valid();
+    if (ok) {
+        std::vector<EventRecord> slots(header.capacity);
+        size_t available = std::fread(slots.data(), sizeof(EventRecord), slots.size(), file);
+        std::uint64_t count = std::min<std::uint64_t>(header.written, header.capacity);
+        std::uint64_t first = header.written > header.capacity ? header.written % header.capacity : 0;
+        ok = available >= count;
+        for (std::uint64_t i = 0; ok && i < count; i++)
+            records.push_back(slots[(first + i) % header.capacity]);
+    }
+    std::fclose(file);
+    return ok;
+}
+
+// Writes records as a file that has never wrapped
+inline bool WriteEventFile(const std::string& path, const std::vector<EventRecord>& records) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    EventFileHeader header;
+    header.Init(records.empty() ? 1 : records.size());
+    header.written = records.size();
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+              && std::fwrite(records.data(), sizeof(EventRecord), records.size(), file) == records.size();
+    return std::fclose(file) == 0 && ok;
+}
+
+#endif //CPPREADY_TRADER_GO_EVENTRECORD_H
@@ -0,0 +1,133 @@
+#ifndef CPPREADY_TRADER_GO_FLOW_H
+#define CPPREADY_TRADER_GO_FLOW_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+#include <ready_trader_go/types.h>
+
+#include "clock.h"
+
+// Rolling statistics of the trades printed on one instrument
+struct FlowStats {
+    double vwap = 0;         // volume weighted average price, in cents
+    double imbalance = 0;    // (bought - sold) / traded volume, from -1 to 1
+    double volatility = 0;   // standard deviation of the VWAP return between trade ticks
+    double arrivalRate = 0;  // trade tick messages per second
+    ptime lastTick{boost::posix_time::not_a_date_time};
+};
+
+// Trade flow of one instrument over its last WINDOW trade tick messages.
+// Each message is reduced to a sample whose contribution is added to and,
+// once it falls out of the ring, subtracted from running sums, so an
+// update is O(1) and nothing allocates. Volumes at the ask count as
+// bought, volumes at the bid as sold.
+class TradeFlow {
+public:
+    static constexpr size_t WINDOW = 32;
+
+    void OnTradeTicks(ptime now, const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askPrices,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askVolumes,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidPrices,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidVolumes) {
+        Sample sample{now, 0, 0, 0, 0, 0};
+        for (size_t i = 0; i < ReadyTraderGo::TOP_LEVEL_COUNT; i++) {
+            sample.notional += askPrices[i] * askVolumes[i] + bidPrices[i] * bidVolumes[i];
+            sample.volume += askVolumes[i] + bidVolumes[i];
+            sample.signedVolume += (long)askVolumes[i] - (long)bidVolumes[i];
+        }
+        if (sample.volume == 0)
+            return;
+
+        double vwap = (double)sample.notional / (double)sample.volume;
+        if (mLastVwap != 0) {
+            double r = (vwap - mLastVwap) / mLastVwap;
+            sample.squaredReturn = r * r;
+            sample.returns = 1;
+        }
+        mLastVwap = vwap;
+
+        if (mCount == WINDOW)
+            Accumulate(mSamples[mHead], -1);
+        else
+            mCount++;
+        mSamples[mHead] = sample;
+        Accumulate(sample, 1);
+        mHead = (mHead + 1) % WINDOW;
+
+        // Derived once here, so readers on the quoting path only load them
+        mStats.vwap = (double)mNotional / (double)mVolume;
+        mStats.imbalance = (double)mSignedVolume / (double)mVolume;
+        mStats.volatility = mReturns != 0 ? std::sqrt(std::max(0.0, mSquaredReturns) / (double)mReturns) : 0;
+        const ptime oldest = mSamples[mCount == WINDOW ? mHead : 0].time;
+        const double span = (double)(now - oldest).total_microseconds() / 1e6;
+        mStats.arrivalRate = span > 0 ? (double)(mCount - 1) / span : 0;
+        mStats.lastTick = now;
+    }
+
+    const FlowStats& Stats() const { return mStats; }
+    size_t Samples() const { return mCount; }
+
+private:
+    struct Sample {
+        ptime time;
+        unsigned long notional, volume;
+        long signedVolume;
+        double squaredReturn;
+        long returns;  // 1 if squaredReturn is set
+    };
+
+    void Accumulate(const Sample& sample, long sign) {
+        mNotional += (unsigned long)sign * sample.notional;
+        mVolume += (unsigned long)sign * sample.volume;
+        mSignedVolume += sign * sample.signedVolume;
+        mSquaredReturns += (double)sign * sample.squaredReturn;
+        mReturns += sign * sample.returns;
+    }
+
+    std::array<Sample, WINDOW> mSamples{};
+    size_t mHead = 0, mCount = 0;
+    unsigned long mNotional = 0, mVolume = 0;
+    long mSignedVolume = 0, mReturns = 0;
+    double mSquaredReturns = 0, mLastVwap = 0;
+    FlowStats mStats;
+};
+
+// Trade flow of both instruments, fed by the trade ticks handler and read
+// in constant time by the quoter
+class TradeFlowAnalytics {
+public:
+    // Flow older than this says nothing about the next fill
+    static inline const time_duration HORIZON = boost::posix_time::seconds(5);
+    // Samples needed before the flow is trusted
+    static constexpr size_t MIN_SAMPLES = TradeFlow::WINDOW / 4;
+
+    explicit TradeFlowAnalytics(const Clock& clock) : mClock(clock) {}
+
+    void OnTradeTicks(ReadyTraderGo::Instrument instrument,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askPrices,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& askVolumes,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidPrices,
+                      const std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>& bidVolumes) {
+        mFlows[(size_t)instrument].OnTradeTicks(mClock.Now(), askPrices, askVolumes, bidPrices, bidVolumes);
+    }
+
+    const FlowStats& Stats(ReadyTraderGo::Instrument instrument) const { return mFlows[(size_t)instrument].Stats(); }
+
+    // Whether recent trades on the instrument were one-sided enough that
+    // resting orders on the other side are likely to be picked off
+    bool Toxic(ReadyTraderGo::Instrument instrument, double imbalanceThreshold) const {
+        const TradeFlow& flow = mFlows[(size_t)instrument];
+        const FlowStats& stats = flow.Stats();
+        return flow.Samples() >= MIN_SAMPLES && std::fabs(stats.imbalance) >= imbalanceThreshold
+               && mClock.Now() - stats.lastTick <= HORIZON;
+    }
+
+private:
+    const Clock& mClock;
+    std::array<TradeFlow, 2> mFlows;
+};
+
+#endif //CPPREADY_TRADER_GO_FLOW_H
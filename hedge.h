@@ -0,0 +1,145 @@
+#ifndef CPPREADY_TRADER_GO_HEDGE_H
+#define CPPREADY_TRADER_GO_HEDGE_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <ready_trader_go/types.h>
+
+#include "clock.h"
+
+struct HedgeStats {
+    unsigned long fills = 0;       // ETF fills handed in
+    unsigned long hedges = 0;      // netted hedges sent
+    unsigned long offset = 0;      // lots that cancelled against opposite fills
+    unsigned long shortfalls = 0;  // hedges that came back short and were re-hedged
+    unsigned long held = 0;        // hedges held back while too many were in flight
+    unsigned long maxPending = 0;  // largest unsent hedge volume, in lots
+};
+
+// Nets the future hedges of ETF fills over a short window, so a sweep
+// through several of our levels costs one hedge instead of one per fill,
+// and fills on opposite sides cancel out. The window opens with the first
+// unhedged fill; a zero window flushes once the reactor has delivered
+// whatever else is ready, i.e. at the end of the current turn. Nothing
+// stays unhedged for longer than the window.
+class HedgeAggregator {
+public:
+    // Sends one hedge order on the future
+    using Sender = std::function<void(ReadyTraderGo::Side side, unsigned long volume)>;
+
+    HedgeAggregator(boost::asio::io_context& context, const Clock& clock, time_duration window, Sender sender)
+        : mContext(context), mClock(clock), mTimer(context), mWindow(window), mSender(std::move(sender)) {}
+
+    // An ETF fill of ours on etfSide, to be hedged the other way
+    void OnFill(ReadyTraderGo::Side etfSide, unsigned long volume) {
+        mStats.fills++;
+        Add(etfSide == ReadyTraderGo::Side::BUY ? -(long)volume : (long)volume);
+    }
+
+    // Future lots a hedge was sent for but did not get, e.g. because the
+    // future book was too thin. They are hedged again with the next flush.
+    void OnShortfall(long futureLots) {
+        if (futureLots == 0)
+            return;
+        mStats.shortfalls++;
+        Add(futureLots);
+    }
+
+    // Future lots owed for any other reason, e.g. after a restart
+    void Owe(long futureLots) {
+        if (futureLots != 0)
+            Add(futureLots);
+    }
+
+    // Future lots a hedge could not be sent for yet. They stay owed, without
+    // opening a window, until Resume or the next fill flushes them.
+    void Hold(long futureLots) {
+        mStats.held++;
+        mPending += futureLots;
+        mStats.maxPending = std::max(mStats.maxPending, (unsigned long)std::labs(mPending));
+    }
+
+    // Opens a window for lots held back, once hedges can be sent again
+    void Resume() {
+        if (mPending != 0 && mDue.is_not_a_date_time())
+            Open();
+    }
+
+    // Future lots owed but not sent yet, positive to buy
+    long Pending() const { return mPending; }
+
+    // When the open window closes, or not_a_date_time if none is open. Lets
+    // simulations that do not run the io_context drive the window.
+    ptime NextFlushTime() const { return mDue; }
+
+    // Sends the netted hedge if the window is due
+    void FlushIfDue() {
+        if (!mDue.is_not_a_date_time() && mClock.Now() >= mDue)
+            Flush();
+    }
+
+    // Sends the netted hedge now
+    void Flush() {
+        mDue = ptime(boost::posix_time::not_a_date_time);
+        if (mPending == 0)
+            return;
+        long pending = mPending;
+        mPending = 0;
+        mStats.hedges++;
+        mSender(pending > 0 ? ReadyTraderGo::Side::BUY : ReadyTraderGo::Side::SELL, (unsigned long)std::labs(pending));
+    }
+
+    const HedgeStats& Stats() const { return mStats; }
+
+private:
+    void Add(long futureLots) {
+        long before = mPending;
+        mPending += futureLots;
+        // Whatever the new lots took off the pending hedge never needs sending
+        mStats.offset += (unsigned long)(std::labs(before) + std::labs(futureLots) - std::labs(mPending)) / 2;
+        mStats.maxPending = std::max(mStats.maxPending, (unsigned long)std::labs(mPending));
+        if (mDue.is_not_a_date_time())
+            Open();
+    }
+
+    void Open() {
+        mDue = mClock.Now() + mWindow;
+        if (mWindow.total_microseconds() == 0) {
+            boost::asio::post(mContext, [this] { FlushIfDue(); });
+            return;
+        }
+        ArmTimer();
+    }
+
+    void ArmTimer() {
+        time_duration wait = mDue - mClock.Now();
+        mTimer.expires_after(std::chrono::microseconds(std::max(0L, (long)wait.total_microseconds())));
+        mTimer.async_wait([this](const boost::system::error_code& error) {
+            if (error || mDue.is_not_a_date_time())
+                return;
+            // The timer runs on the steady clock, the window on mClock
+            if (mClock.Now() >= mDue)
+                Flush();
+            else
+                ArmTimer();
+        });
+    }
+
+    boost::asio::io_context& mContext;
+    const Clock& mClock;
+    boost::asio::steady_timer mTimer;
+    const time_duration mWindow;
+    Sender mSender;
+    long mPending = 0;
+    ptime mDue{boost::posix_time::not_a_date_time};
+    HedgeStats mStats;
+};
+
+#endif //CPPREADY_TRADER_GO_HEDGE_H
@@ -0,0 +1,201 @@
+#ifndef CPPREADY_TRADER_GO_JOURNAL_H
+#define CPPREADY_TRADER_GO_JOURNAL_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <ready_trader_go/types.h>
+
+#include "clock.h"
+#include "eventrecord.h"
+
+// Binary journal of everything crossing the exchange boundary, in the event
+// file format, so a journal can be decoded or replayed as it is.
+//
+// The file is mapped shared and prefaulted when opened. Appending fills the
+// next slot of the ring and publishes it by bumping the header's written
+// count, without formatting, locking or system calls. Once written pages
+// are in the page cache they survive a crash of the process; a background
+// thread msyncs them periodically so they also reach the disk.
+class EventJournal {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;  // 128 MiB of records
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{100};
+
+    explicit EventJournal(const Clock& clock) : mClock(clock) {}
+    ~EventJournal() { Close(); }
+
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    // Creates or truncates path to hold capacity records. Returns false if
+    // the file cannot be created or mapped, the journal then stays closed.
+    bool Open(const std::string& path, size_t capacity = DEFAULT_CAPACITY) {
+        Close();
+        if (capacity == 0)
+            return false;
+        mSize = sizeof(EventFileHeader) + capacity * sizeof(EventRecord);
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+        void* map = ::ftruncate(fd, (off_t)mSize) == 0
+                    ? ::mmap(nullptr, mSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0)
+                    : MAP_FAILED;
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return false;
+
+        mHeader = static_cast<EventFileHeader*>(map);
+        mHeader->Init(capacity);
+        mRecords = reinterpret_cast<EventRecord*>(mHeader + 1);
+        mCapacity = capacity;
+        mWritten = 0;
+        mFlushed = 0;
+        mStopping = false;
+        mFlusher = std::thread([this] { FlushLoop(); });
+        return true;
+    }
+
+    // Stops the flush thread, syncs everything and unmaps the file
+    void Close() {
+        if (mHeader == nullptr)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mWake.notify_one();
+        mFlusher.join();
+        Flush(MS_SYNC);
+        ::munmap(mHeader, mSize);
+        mHeader = nullptr;
+        mRecords = nullptr;
+    }
+
+    bool IsOpen() const { return mHeader != nullptr; }
+    std::uint64_t Written() const { return mWritten; }
+
+    // Hot path appends, no-ops while the journal is closed
+
+    void Event(EventType type, unsigned long id) {
+        if (!IsOpen())
+            return;
+        Slot(type, id);
+        Publish();
+    }
+
+    // Fills, hedge fills and order statuses, see EventRecord::OrderFields
+    void OrderEvent(EventType type, unsigned long id, unsigned long price, unsigned long volume, long fees = 0) {
+        if (!IsOpen())
+            return;
+        EventRecord& record = Slot(type, id);
+        record.order.price = price;
+        record.order.volume = volume;
+        record.order.fees = fees;
+        Publish();
+    }
+
+    template<typename Array>
+    void BookEvent(EventType type, ReadyTraderGo::Instrument instrument, unsigned long sequenceNumber,
+                   const Array& askPrices, const Array& askVolumes, const Array& bidPrices, const Array& bidVolumes) {
+        if (!IsOpen())
+            return;
+        EventRecord& record = Slot(type, sequenceNumber);
+        record.instrument = (std::uint8_t)instrument;
+        PackLevels(record.book.askPrices, askPrices);
+        PackLevels(record.book.askVolumes, askVolumes);
+        PackLevels(record.book.bidPrices, bidPrices);
+        PackLevels(record.book.bidVolumes, bidVolumes);
+        Publish();
+    }
+
+    void ErrorEvent(unsigned long id, const std::string& message) {
+        if (!IsOpen())
+            return;
+        EventRecord& record = Slot(EventType::ERROR, id);
+        std::memcpy(record.text, message.data(), std::min(message.size(), EventRecord::TEXT_LENGTH - 1));
+        Publish();
+    }
+
+    void SendEvent(EventType type, unsigned long id, ReadyTraderGo::Side side, ReadyTraderGo::Lifespan lifespan,
+                   unsigned long price, unsigned long volume) {
+        if (!IsOpen())
+            return;
+        EventRecord& record = Slot(type, id);
+        record.side = (std::uint8_t)side;
+        record.lifespan = (std::uint8_t)lifespan;
+        record.order.price = price;
+        record.order.volume = volume;
+        Publish();
+    }
+
+private:
+    // Clears the next slot and fills in the common fields
+    EventRecord& Slot(EventType type, unsigned long id) {
+        EventRecord& record = mRecords[mWritten % mCapacity];
+        std::memset(&record, 0, sizeof(record));
+        record.sequence = mWritten;
+        record.timestamp = ToEventTime(mClock.Now());
+        record.type = type;
+        record.id = id;
+        return record;
+    }
+
+    // Only the reactor thread appends, the release store orders the record
+    // before the count for the flush thread and for readers of the file
+    void Publish() { __atomic_store_n(&mHeader->written, ++mWritten, __ATOMIC_RELEASE); }
+
+    void FlushLoop() {
+        std::unique_lock<std::mutex> lock(mMutex);
+        while (!mStopping) {
+            mWake.wait_for(lock, FLUSH_INTERVAL, [this] { return mStopping; });
+            Flush(MS_ASYNC);
+        }
+    }
+
+    // Syncs the records published since the last flush, then the header
+    void Flush(int flags) {
+        std::uint64_t written = __atomic_load_n(&mHeader->written, __ATOMIC_ACQUIRE);
+        if (written == mFlushed)
+            return;
+        std::uint64_t first = std::max(mFlushed, written > mCapacity ? written - mCapacity : 0);
+        std::uint64_t begin = first % mCapacity, count = written - first;
+        std::uint64_t head = std::min(count, mCapacity - begin);
+        SyncRange(sizeof(EventFileHeader) + begin * sizeof(EventRecord), head * sizeof(EventRecord), flags);
+        if (count > head)
+            SyncRange(sizeof(EventFileHeader), (count - head) * sizeof(EventRecord), flags);
+        SyncRange(0, sizeof(EventFileHeader), flags);
+        mFlushed = written;
+    }
+
+    void SyncRange(size_t offset, size_t length, int flags) {
+        static const size_t pageSize = (size_t)::sysconf(_SC_PAGESIZE);
+        size_t aligned = offset & ~(pageSize - 1);
+        ::msync(reinterpret_cast<char*>(mHeader) + aligned, length + offset - aligned, flags);
+    }
+
+    const Clock& mClock;
+    EventFileHeader* mHeader = nullptr;
+    EventRecord* mRecords = nullptr;
+    size_t mSize = 0;
+    std::uint64_t mCapacity = 0;
+    std::uint64_t mWritten = 0;
+    std::uint64_t mFlushed = 0;  // owned by the flush thread while it runs
+
+    std::thread mFlusher;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    bool mStopping = false;
+};
+
+#endif //CPPREADY_TRADER_GO_JOURNAL_H
@@ -0,0 +1,205 @@
+#ifndef CPPREADY_TRADER_GO_LATENCY_H
+#define CPPREADY_TRADER_GO_LATENCY_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Cheapest available timestamp: the TSC on x86, the steady clock elsewhere
+inline std::uint64_t ReadTsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Log-linear histogram in the style of HdrHistogram: values below
+// 2^SUB_BITS are counted exactly, above that every power of two is split
+// into 2^SUB_BITS buckets, giving about 6% relative precision over
+// [0, 2^MAX_BITS) cycles. There is a single writer (the reactor thread);
+// readers may run concurrently and see a slightly stale but never torn
+// count, so recording needs neither locks nor atomic read-modify-writes.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BITS = 4;
+    static constexpr unsigned MAX_BITS = 40;
+    static constexpr size_t SUB_COUNT = 1u << SUB_BITS;
+    static constexpr size_t BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+    void Record(std::uint64_t value) {
+        Bump(mCounts[Index(value)]);
+        Bump(mTotal);
+        if (value > mMax.load(std::memory_order_relaxed))
+            mMax.store(value, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Count() const { return mTotal.load(std::memory_order_relaxed); }
+    std::uint64_t Max() const { return mMax.load(std::memory_order_relaxed); }
+
+    // Upper bound of the bucket holding the q-th quantile
+    std::uint64_t Percentile(double q) const {
+        std::uint64_t total = Count();
+        if (total == 0)
+            return 0;
+        std::uint64_t rank = (std::uint64_t)(q * (double)(total - 1)) + 1, seen = 0;
+        for (size_t i = 0; i < BUCKETS; i++) {
+            seen += mCounts[i].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return UpperBound(i);
+        }
+        return Max();
+    }
+
+    void Reset() {
+        for (auto& count : mCounts)
+            count.store(0, std::memory_order_relaxed);
+        mTotal.store(0, std::memory_order_relaxed);
+        mMax.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static void Bump(std::atomic<std::uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    static size_t Index(std::uint64_t value) {
+        if (value < SUB_COUNT)
+            return (size_t)value;
+        unsigned magnitude = 63 - (unsigned)__builtin_clzll(value);  // >= SUB_BITS
+        if (magnitude >= MAX_BITS)
+            return BUCKETS - 1;
+        unsigned shift = magnitude - SUB_BITS;
+        // Drop the leading one, keep the next SUB_BITS bits
+        size_t sub = (size_t)(value >> shift) & (SUB_COUNT - 1);
+        return (size_t)(shift + 1) * SUB_COUNT + sub;
+    }
+
+    static std::uint64_t UpperBound(size_t index) {
+        if (index < SUB_COUNT)
+            return index;
+        size_t shift = index / SUB_COUNT - 1;
+        std::uint64_t base = (std::uint64_t)(SUB_COUNT + index % SUB_COUNT) << shift;
+        return base + ((std::uint64_t)1 << shift) - 1;
+    }
+
+    std::array<std::atomic<std::uint64_t>, BUCKETS> mCounts{};
+    std::atomic<std::uint64_t> mTotal{0};
+    std::atomic<std::uint64_t> mMax{0};
+};
+
+// Instrumented code paths of AutoTrader
+enum class Probe : std::uint8_t {
+    DISCONNECT,
+    ERROR,
+    HEDGE_FILLED,
+    ORDER_BOOK,
+    ORDER_FILLED,
+    ORDER_STATUS,
+    TRADE_TICKS,
+    SEND_AMEND,
+    SEND_CANCEL,
+    SEND_HEDGE,
+    SEND_INSERT,
+    QUOTE_PASS,     // re-quoting from the latest future book
+    TICK_TO_TRADE,  // book arrival to the first insert or cancel it caused
+    COUNT
+};
+
+inline const char* ProbeName(Probe probe) {
+    static constexpr const char* names[] = {"DISCONNECT", "ERROR", "HEDGE_FILLED", "ORDER_BOOK", "ORDER_FILLED",
+                                            "ORDER_STATUS", "TRADE_TICKS", "SEND_AMEND", "SEND_CANCEL",
+                                            "SEND_HEDGE", "SEND_INSERT", "QUOTE_PASS", "TICK_TO_TRADE"};
+    return names[(size_t)probe];
+}
+
+// One histogram per probe plus the book-to-order stamp. Values are kept in
+// TSC cycles and only converted to nanoseconds when dumped.
+class LatencyRecorder {
+public:
+    LatencyRecorder() : mStartTsc(ReadTsc()), mStart(std::chrono::steady_clock::now()) {}
+
+    void Record(Probe probe, std::uint64_t cycles) { mHistograms[(size_t)probe].Record(cycles); }
+
+    const LatencyHistogram& Histogram(Probe probe) const { return mHistograms[(size_t)probe]; }
+
+    // Bracket the synchronous handling of a book update that may lead to
+    // orders. Work deferred to a later turn brackets itself again with the
+    // arrival it captured, so books handled in between cannot clear it.
+    void BookArrived(std::uint64_t tsc) { mBookTsc = tsc; }
+    void BookHandled() { mBookTsc = 0; }
+
+    // Called before an insert or cancel leaves, records tick-to-trade for the
+    // first one after a book update
+    void OrderSent() {
+        if (mBookTsc != 0) {
+            Record(Probe::TICK_TO_TRADE, ReadTsc() - mBookTsc);
+            mBookTsc = 0;
+        }
+    }
+
+    // Writes a percentile table in nanoseconds
+    void Dump(std::FILE* out) const {
+        double nsPerCycle = NanosecondsPerCycle();
+        std::fprintf(out, "%-14s %10s %9s %9s %9s %9s %9s\n", "probe (ns)", "count", "p50", "p90", "p99", "p99.9",
+                     "max");
+        for (size_t i = 0; i < (size_t)Probe::COUNT; i++) {
+            const LatencyHistogram& histogram = mHistograms[i];
+            if (histogram.Count() == 0)
+                continue;
+            auto ns = [nsPerCycle](std::uint64_t cycles) { return (unsigned long long)((double)cycles * nsPerCycle); };
+            std::fprintf(out, "%-14s %10llu %9llu %9llu %9llu %9llu %9llu\n", ProbeName((Probe)i),
+                         (unsigned long long)histogram.Count(), ns(histogram.Percentile(0.5)),
+                         ns(histogram.Percentile(0.9)), ns(histogram.Percentile(0.99)),
+                         ns(histogram.Percentile(0.999)), ns(histogram.Max()));
+        }
+        std::fflush(out);
+    }
+
+private:
+    // TSC rate from the recorder's lifetime, or from a short busy wait if it
+    // has not been alive long enough to be accurate
+    double NanosecondsPerCycle() const {
+        std::uint64_t startTsc = mStartTsc;
+        auto start = mStart;
+        if (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(10)) {
+            startTsc = ReadTsc();
+            start = std::chrono::steady_clock::now();
+            while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(10)) {}
+        }
+        std::uint64_t cycles = ReadTsc() - startTsc;
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        return cycles == 0 ? 1.0 : (double)elapsed.count() / (double)cycles;
+    }
+
+    std::array<LatencyHistogram, (size_t)Probe::COUNT> mHistograms;
+    std::uint64_t mBookTsc = 0;
+    const std::uint64_t mStartTsc;
+    const std::chrono::steady_clock::time_point mStart;
+};
+
+// Records the cycles spent in the enclosing scope
+class ScopedProbe {
+public:
+    ScopedProbe(LatencyRecorder& recorder, Probe probe) : mRecorder(recorder), mProbe(probe), mStart(ReadTsc()) {}
+    ~ScopedProbe() { mRecorder.Record(mProbe, ReadTsc() - mStart); }
+
+    ScopedProbe(const ScopedProbe&) = delete;
+    ScopedProbe& operator=(const ScopedProbe&) = delete;
+
+    std::uint64_t Start() const { return mStart; }
+
+private:
+    LatencyRecorder& mRecorder;
+    const Probe mProbe;
+    const std::uint64_t mStart;
+};
+
+#endif //CPPREADY_TRADER_GO_LATENCY_H
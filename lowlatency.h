@@ -0,0 +1,110 @@
+#ifndef CPPREADY_TRADER_GO_LOWLATENCY_H
+#define CPPREADY_TRADER_GO_LOWLATENCY_H
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <alloca.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/post.hpp>
+
+#include "debug.h"
+
+struct LowLatencyOptions {
+    int cpu = -1;                     // core to pin the reactor to, -1 leaves the affinity alone
+    int fifoPriority = 0;             // SCHED_FIFO priority, 0 keeps the default scheduler
+    bool lockMemory = true;           // mlockall and keep freed heap memory mapped
+    size_t prefaultStack = 1 << 20;   // bytes of stack to touch up front
+    int warmUpRounds = 2000;          // synthetic books run through the handlers before trading
+
+    // Low latency mode is opt-in: AUTOTRADER_LOW_LATENCY=1 enables it,
+    // AUTOTRADER_CPU and AUTOTRADER_FIFO_PRIORITY set the core and the
+    // real-time priority. Returns false if it is not enabled.
+    static bool FromEnvironment(LowLatencyOptions& options) {
+        const char* enabled = std::getenv("AUTOTRADER_LOW_LATENCY");
+        if (enabled == nullptr || std::strcmp(enabled, "1") != 0)
+            return false;
+        if (const char* cpu = std::getenv("AUTOTRADER_CPU"))
+            options.cpu = std::atoi(cpu);
+        if (const char* priority = std::getenv("AUTOTRADER_FIFO_PRIORITY"))
+            options.fifoPriority = std::atoi(priority);
+        return true;
+    }
+};
+
+// Prepares the thread that runs the io_context for low and, above all,
+// predictable latency. Start must be called on that thread before run():
+// the AutoTrader constructor is, in the Ready Trader Go main.
+//
+// The reactor never sleeps: a handler that re-posts itself keeps the
+// io_context's queue non-empty, so run() polls the sockets without
+// blocking between handlers instead of waiting in epoll and paying a
+// wakeup on every packet. That burns the core it runs on, so pin it to an
+// isolated one (isolcpus/nohz_full). With SCHED_FIFO on a core that is not
+// isolated, the spinning reactor starves everything else on it.
+class LowLatencyRuntime {
+public:
+    explicit LowLatencyRuntime(boost::asio::io_context& context) : mContext(context) {}
+
+    void Start(const LowLatencyOptions& options) {
+        if (options.cpu >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(options.cpu, &set);
+            if (int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+                RLOG(LG_AT, ReadyTraderGo::LogLevel::LL_WARNING) << "cannot pin reactor to cpu " << options.cpu << ": "
+                                                                 << std::strerror(error);
+        }
+
+        if (options.lockMemory) {
+            // Freed heap memory stays mapped and locked instead of faulting in again
+            mallopt(M_TRIM_THRESHOLD, -1);
+            mallopt(M_MMAP_MAX, 0);
+            if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+                RLOG(LG_AT, ReadyTraderGo::LogLevel::LL_WARNING) << "cannot lock memory: " << std::strerror(errno);
+        }
+        PrefaultStack(options.prefaultStack);
+
+        if (options.fifoPriority > 0) {
+            sched_param param{};
+            param.sched_priority = options.fifoPriority;
+            if (int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param))
+                RLOG(LG_AT, ReadyTraderGo::LogLevel::LL_WARNING) << "cannot switch to SCHED_FIFO: " << std::strerror(error);
+        }
+
+        mSpinning = true;
+        Spin();
+        RLOG(LG_AT, ReadyTraderGo::LogLevel::LL_INFO) << "low latency mode on cpu " << options.cpu << ", SCHED_FIFO priority "
+                                                      << options.fifoPriority;
+    }
+
+    // Lets run() return once nothing else is left to do
+    void Stop() { mSpinning = false; }
+
+    bool Active() const { return mSpinning; }
+
+private:
+    void Spin() {
+        if (mSpinning)
+            boost::asio::post(mContext, [this] { Spin(); });
+    }
+
+    // Touches the stack the handlers will use, so its pages are mapped,
+    // and with mlockall locked, before the first packet arrives
+    static void PrefaultStack(size_t bytes) {
+        volatile char* stack = static_cast<volatile char*>(alloca(bytes));
+        for (size_t i = 0; i < bytes; i += 4096)
+            stack[i] = 0;
+    }
+
+    boost::asio::io_context& mContext;
+    bool mSpinning = false;
+};
+
+#endif //CPPREADY_TRADER_GO_LOWLATENCY_H
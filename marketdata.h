@@ -0,0 +1,133 @@
+#ifndef CPPREADY_TRADER_GO_MARKETDATA_H
+#define CPPREADY_TRADER_GO_MARKETDATA_H
+
+#include <array>
+#include <cstddef>
+
+#include <ready_trader_go/types.h>
+
+// Latest order book of one instrument
+struct BookSnapshot {
+    using Levels = std::array<unsigned long, ReadyTraderGo::TOP_LEVEL_COUNT>;
+
+    unsigned long sequenceNumber = 0;
+    Levels askPrices{}, askVolumes{}, bidPrices{}, bidVolumes{};
+
+    unsigned long BestBid() const { return bidPrices[0]; }
+    unsigned long BestAsk() const { return askPrices[0]; }
+};
+
+// What a quoting pass depends on. The inventory skew and the position
+// capacity of both sides are functions of the position, spread and depth
+// of the ladder depend on whether the trade flow is toxic.
+struct QuoteInputs {
+    unsigned long bestBid, bestAsk;
+    long position;
+    bool toxic;
+
+    bool operator==(const QuoteInputs& other) const {
+        return bestBid == other.bestBid && bestAsk == other.bestAsk && position == other.position
+               && toxic == other.toxic;
+    }
+};
+
+struct MarketDataStats {
+    unsigned long accepted = 0;
+    unsigned long stale = 0;      // not newer than the last accepted update, dropped
+    unsigned long gaps = 0;       // updates that skipped at least one sequence number
+    unsigned long missed = 0;     // sequence numbers skipped in total
+    unsigned long conflated = 0;  // books superseded before their quoting pass ran
+    unsigned long passes = 0;
+    unsigned long skipped = 0;    // passes with unchanged inputs
+};
+
+// Front stage between the market data handlers and quoting. Updates are
+// sequenced per instrument and message type, and anything older than what
+// was already seen is dropped; books are full snapshots, so a gap needs no
+// recovery and is only counted. Accepted books replace the instrument's
+// snapshot, and all books arriving before the next quoting pass collapse
+// into that one pass, which is skipped if its inputs did not change.
+class MarketDataStage {
+public:
+    // Returns false if the book is stale
+    bool OnOrderBook(ReadyTraderGo::Instrument instrument, unsigned long sequenceNumber,
+                     const BookSnapshot::Levels& askPrices, const BookSnapshot::Levels& askVolumes,
+                     const BookSnapshot::Levels& bidPrices, const BookSnapshot::Levels& bidVolumes) {
+        BookSnapshot& book = mBooks[(size_t)instrument];
+        if (!Sequence(book.sequenceNumber, sequenceNumber))
+            return false;
+        book.askPrices = askPrices;
+        book.askVolumes = askVolumes;
+        book.bidPrices = bidPrices;
+        book.bidVolumes = bidVolumes;
+        return true;
+    }
+
+    // Returns false if the trade ticks are stale
+    bool OnTradeTicks(ReadyTraderGo::Instrument instrument, unsigned long sequenceNumber) {
+        return Sequence(mTicksSequence[(size_t)instrument], sequenceNumber);
+    }
+
+    const BookSnapshot& Book(ReadyTraderGo::Instrument instrument) const { return mBooks[(size_t)instrument]; }
+
+    // Whether both books are from the same exchange tick, which publishes
+    // them with a shared sequence number
+    bool Synchronized() const {
+        return mBooks[0].sequenceNumber != 0 && mBooks[0].sequenceNumber == mBooks[1].sequenceNumber;
+    }
+
+    // Returns true if a quoting pass has to be scheduled, false if one is
+    // already pending and will pick up the new book
+    bool RequestPass() {
+        if (mPassPending) {
+            mStats.conflated++;
+            return false;
+        }
+        mPassPending = true;
+        return true;
+    }
+
+    // Starts the pending pass. Returns false if it can be skipped because
+    // nothing it depends on changed since the last pass that ran.
+    bool BeginPass(const QuoteInputs& inputs) {
+        mPassPending = false;
+        mStats.passes++;
+        if (mLastValid && inputs == mLast) {
+            mStats.skipped++;
+            return false;
+        }
+        mLast = inputs;
+        mLastValid = true;
+        return true;
+    }
+
+    // Forces the next pass to run, e.g. after our orders changed or the
+    // last pass ran out of message budget
+    void Invalidate() { mLastValid = false; }
+
+    const MarketDataStats& Stats() const { return mStats; }
+
+private:
+    bool Sequence(unsigned long& last, unsigned long sequenceNumber) {
+        if (sequenceNumber <= last) {
+            mStats.stale++;
+            return false;
+        }
+        if (last != 0 && sequenceNumber != last + 1) {
+            mStats.gaps++;
+            mStats.missed += sequenceNumber - last - 1;
+        }
+        last = sequenceNumber;
+        mStats.accepted++;
+        return true;
+    }
+
+    std::array<BookSnapshot, 2> mBooks{};
+    std::array<unsigned long, 2> mTicksSequence{};
+    QuoteInputs mLast{};
+    bool mLastValid = false;
+    bool mPassPending = false;
+    MarketDataStats mStats;
+};
+
+#endif //CPPREADY_TRADER_GO_MARKETDATA_H
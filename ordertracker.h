@@ -0,0 +1,235 @@
+#ifndef CPPREADY_TRADER_GO_ORDERTRACKER_H
+#define CPPREADY_TRADER_GO_ORDERTRACKER_H
+
+#include <array>
+#include <cstdint>
+
+#include <ready_trader_go/types.h>
+
+#include "constants.h"
+
+// Lifecycle of one of our orders as far as we know it. Requests move an
+// order into a PENDING_ state, the exchange's OrderStatus (or error)
+// messages move it back to LIVE or on to DONE.
+enum class OrderState : unsigned char {
+    PENDING_NEW,     // insert sent, not yet acknowledged
+    LIVE,            // resting on the exchange
+    PENDING_CANCEL,  // cancel sent, the order can still be filled until it is DONE
+    PENDING_AMEND,   // volume reduction to amendVolume in total sent
+    DONE             // fully filled, cancelled or rejected, slot is free
+};
+
+// volume is what is left to trade. The exchange counts an amend's volume
+// against everything the order was, so amendVolume and filled are totals.
+struct Order {
+    unsigned long price, volume, orderId;
+    ReadyTraderGo::Side side;
+    OrderState state;
+    unsigned long amendVolume;  // total volume of the amend in flight
+    unsigned long filled;       // volume traded so far
+};
+
+// One side of our own quotes, indexed by tick. A price lives in the slot
+// (price / TICK_SIZE_IN_CENTS) % LADDER_TICKS, which is collision free as
+// long as all live levels fall within LADDER_TICKS consecutive ticks of the
+// lowest one (the anchor). Entries refer to slots of the OrderTracker slab.
+class PriceLadder {
+public:
+    static constexpr std::uint8_t EMPTY = 0xFF;
+
+    PriceLadder() : mLow(0), mHigh(0), mCount(0) {
+        mLevels.fill(EMPTY);
+    }
+
+    bool Empty() const { return mCount == 0; }
+    unsigned int Size() const { return mCount; }
+    unsigned long LowPrice() const { return mLow * TICK_SIZE_IN_CENTS; }
+    unsigned long HighPrice() const { return mHigh * TICK_SIZE_IN_CENTS; }
+
+    // Slab slot of the order resting at price, or EMPTY
+    std::uint8_t At(unsigned long price) const {
+        unsigned long tick = price / TICK_SIZE_IN_CENTS;
+        if (mCount == 0 || tick < mLow || tick > mHigh)
+            return EMPTY;
+        return mLevels[tick % LADDER_TICKS];
+    }
+
+    bool Contains(unsigned long price) const { return At(price) != EMPTY; }
+
+    // Whether price can be added without leaving the tick window
+    bool Fits(unsigned long price) const {
+        unsigned long tick = price / TICK_SIZE_IN_CENTS;
+        if (mCount == 0)
+            return true;
+        unsigned long low = tick < mLow ? tick : mLow;
+        unsigned long high = tick > mHigh ? tick : mHigh;
+        return high - low < LADDER_TICKS;
+    }
+
+    void Place(unsigned long price, std::uint8_t slot) {
+        unsigned long tick = price / TICK_SIZE_IN_CENTS;
+        if (mCount == 0) {
+            mLow = mHigh = tick;
+        } else {
+            if (tick < mLow) mLow = tick;
+            if (tick > mHigh) mHigh = tick;
+        }
+        mLevels[tick % LADDER_TICKS] = slot;
+        mCount++;
+    }
+
+    void Remove(unsigned long price) {
+        unsigned long tick = price / TICK_SIZE_IN_CENTS;
+        mLevels[tick % LADDER_TICKS] = EMPTY;
+        if (--mCount == 0)
+            return;
+        // Pull the anchor in so the window can move along with the market
+        if (tick == mLow)
+            while (mLevels[mLow % LADDER_TICKS] == EMPTY) mLow++;
+        if (tick == mHigh)
+            while (mLevels[mHigh % LADDER_TICKS] == EMPTY) mHigh--;
+    }
+
+    // Visits the slab slot of every level, from the lowest price upwards
+    template<typename F>
+    void ForEach(F&& f) const {
+        if (mCount == 0)
+            return;
+        for (unsigned long tick = mLow; tick <= mHigh; tick++) {
+            std::uint8_t slot = mLevels[tick % LADDER_TICKS];
+            if (slot != EMPTY)
+                f(slot);
+        }
+    }
+
+private:
+    std::array<std::uint8_t, LADDER_TICKS> mLevels;
+    unsigned long mLow, mHigh;
+    unsigned int mCount;
+};
+
+// Single source of truth for our resting ETF orders. Orders live in a
+// preallocated slab, are found by id through a small open-addressed table
+// and by price through one PriceLadder per side. Nothing on the handler
+// path allocates.
+class OrderTracker {
+    static_assert(MAX_TRACKED_ORDERS < PriceLadder::EMPTY, "slot indices must fit the ladder");
+    static constexpr size_t ID_TABLE_SIZE = 2 * MAX_TRACKED_ORDERS;
+    static_assert((ID_TABLE_SIZE & (ID_TABLE_SIZE - 1)) == 0, "id table size must be a power of two");
+    static constexpr std::uint8_t NO_SLOT = PriceLadder::EMPTY;
+
+public:
+    OrderTracker() : mFreeCount(MAX_TRACKED_ORDERS) {
+        for (size_t i = 0; i < MAX_TRACKED_ORDERS; i++)
+            mFreeSlots[i] = (std::uint8_t)(MAX_TRACKED_ORDERS - 1 - i);
+        mIdSlots.fill(NO_SLOT);
+        mIdKeys.fill(0);
+    }
+
+    PriceLadder& Ladder(ReadyTraderGo::Side side) { return side == ReadyTraderGo::Side::BUY ? mBids : mAsks; }
+    const PriceLadder& Ladder(ReadyTraderGo::Side side) const { return side == ReadyTraderGo::Side::BUY ? mBids : mAsks; }
+
+    Order& Slot(std::uint8_t slot) { return mOrders[slot]; }
+    const Order& Slot(std::uint8_t slot) const { return mOrders[slot]; }
+
+    // Whether an order at this price could be tracked right now
+    bool CanTrack(ReadyTraderGo::Side side, unsigned long price) const {
+        const PriceLadder& ladder = Ladder(side);
+        return mFreeCount != 0 && !ladder.Contains(price) && ladder.Fits(price);
+    }
+
+    // Records a new order, CanTrack must have been checked beforehand
+    Order* Track(ReadyTraderGo::Side side, unsigned long price, unsigned long volume, unsigned long orderId) {
+        std::uint8_t slot = mFreeSlots[--mFreeCount];
+        Order& order = mOrders[slot];
+        order.price = price;
+        order.volume = volume;
+        order.orderId = orderId;
+        order.side = side;
+        order.state = OrderState::PENDING_NEW;
+        order.amendVolume = volume;
+        order.filled = 0;
+        Ladder(side).Place(price, slot);
+        IdInsert(orderId, slot);
+        return &order;
+    }
+
+    Order* Find(unsigned long orderId) {
+        size_t i = IdFind(orderId);
+        return i == ID_TABLE_SIZE ? nullptr : &mOrders[mIdSlots[i]];
+    }
+
+    Order* AtPrice(ReadyTraderGo::Side side, unsigned long price) {
+        std::uint8_t slot = Ladder(side).At(price);
+        return slot == NO_SLOT ? nullptr : &mOrders[slot];
+    }
+
+    void Release(Order* order) {
+        std::uint8_t slot = (std::uint8_t)(order - mOrders.data());
+        order->state = OrderState::DONE;
+        Ladder(order->side).Remove(order->price);
+        IdErase(IdFind(order->orderId));
+        mFreeSlots[mFreeCount++] = slot;
+    }
+
+    // Visits every order on one side, from the lowest price upwards
+    template<typename F>
+    void ForEach(ReadyTraderGo::Side side, F&& f) {
+        Ladder(side).ForEach([&](std::uint8_t slot) { f(mOrders[slot]); });
+    }
+
+    size_t Size() const { return MAX_TRACKED_ORDERS - mFreeCount; }
+
+private:
+    static size_t IdHash(unsigned long orderId) {
+        // Fibonacci hashing, ids are sequential so this spreads them evenly
+        return (size_t)((orderId * 0x9E3779B97F4A7C15ULL) >> 32) & (ID_TABLE_SIZE - 1);
+    }
+
+    size_t IdFind(unsigned long orderId) const {
+        for (size_t i = IdHash(orderId);; i = (i + 1) & (ID_TABLE_SIZE - 1)) {
+            if (mIdSlots[i] == NO_SLOT)
+                return ID_TABLE_SIZE;
+            if (mIdKeys[i] == orderId)
+                return i;
+        }
+    }
+
+    void IdInsert(unsigned long orderId, std::uint8_t slot) {
+        size_t i = IdHash(orderId);
+        while (mIdSlots[i] != NO_SLOT)
+            i = (i + 1) & (ID_TABLE_SIZE - 1);
+        mIdKeys[i] = orderId;
+        mIdSlots[i] = slot;
+    }
+
+    // Backward shift deletion, keeps probe sequences intact without tombstones
+    void IdErase(size_t i) {
+        if (i == ID_TABLE_SIZE)
+            return;
+        size_t j = i;
+        for (;;) {
+            j = (j + 1) & (ID_TABLE_SIZE - 1);
+            if (mIdSlots[j] == NO_SLOT)
+                break;
+            size_t home = IdHash(mIdKeys[j]);
+            // Move j back into the hole at i unless its home lies in (i, j]
+            if (((j - home) & (ID_TABLE_SIZE - 1)) >= ((j - i) & (ID_TABLE_SIZE - 1))) {
+                mIdKeys[i] = mIdKeys[j];
+                mIdSlots[i] = mIdSlots[j];
+                i = j;
+            }
+        }
+        mIdSlots[i] = NO_SLOT;
+    }
+
+    std::array<Order, MAX_TRACKED_ORDERS> mOrders{};
+    std::array<std::uint8_t, MAX_TRACKED_ORDERS> mFreeSlots;
+    size_t mFreeCount;
+    std::array<unsigned long, ID_TABLE_SIZE> mIdKeys;
+    std::array<std::uint8_t, ID_TABLE_SIZE> mIdSlots;
+    PriceLadder mBids;
+    PriceLadder mAsks;
+};
+
+#endif //CPPREADY_TRADER_GO_ORDERTRACKER_H
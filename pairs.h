@@ -0,0 +1,46 @@
+#ifndef CPPREADY_TRADER_GO_PAIRS_H
+#define CPPREADY_TRADER_GO_PAIRS_H
+
+#include <cstddef>
+
+#include <ready_trader_go/types.h>
+
+#include "constants.h"
+
+// An ETF quoted against the future that hedges it. Within its pair an
+// instrument plays the role of FUT or ETF, which is how the per-pair
+// stages (market data, flow, arbitrage) index their books.
+template <ReadyTraderGo::Instrument Etf, ReadyTraderGo::Instrument Future>
+struct InstrumentPair {
+    static constexpr ReadyTraderGo::Instrument ETF_INSTRUMENT = Etf;
+    static constexpr ReadyTraderGo::Instrument FUTURE_INSTRUMENT = Future;
+
+    static constexpr bool Contains(ReadyTraderGo::Instrument instrument) {
+        return instrument == Etf || instrument == Future;
+    }
+    static constexpr ReadyTraderGo::Instrument Role(ReadyTraderGo::Instrument instrument) {
+        return instrument == Future ? FUT : ETF;
+    }
+};
+
+template <typename... Pairs>
+struct PairList {
+    static constexpr size_t COUNT = sizeof...(Pairs);
+};
+
+// The pairs one process trades. Ready Trader Go has a single ETF and a
+// single future; each further pair gets its own strategy instance.
+using TradedPairs = PairList<InstrumentPair<ETF, FUT>>;
+
+// Client order ids carry the index of the pair they belong to, so the
+// handlers of order events find it without a lookup. With a single pair
+// ids are simply consecutive.
+constexpr unsigned long OrderIdFor(unsigned long sequence, size_t pair) {
+    return sequence * TradedPairs::COUNT + pair;
+}
+constexpr size_t PairOfOrder(unsigned long orderId) { return orderId % TradedPairs::COUNT; }
+
+static_assert(OrderIdFor(7, 0) == 7 || TradedPairs::COUNT != 1);
+static_assert(PairOfOrder(OrderIdFor(7, TradedPairs::COUNT - 1)) == TradedPairs::COUNT - 1);
+
+#endif //CPPREADY_TRADER_GO_PAIRS_H
@@ -0,0 +1,50 @@
+#ifndef CPPREADY_TRADER_GO_PARAMETERS_H
+#define CPPREADY_TRADER_GO_PARAMETERS_H
+
+#include "constants.h"
+
+// Upper bound on the quoted levels per side, keeps the ladder well inside
+// the order tracker's capacity and tick window
+constexpr int MAX_CLONES = 16;
+
+// Tunable knobs of the market making strategy. The defaults are what the
+// trader runs with; the offline tools construct traders with other values
+// so tuning does not need a rebuild.
+struct StrategyParameters {
+    // Price levels quoted on each side
+    int numClones = NUM_CLONES;
+    // Distance of the front quotes beyond the future's best bid/ask, in cents
+    unsigned long additionalSpread = ADDITIONAL_SPREAD;
+    // Volume quoted per level
+    unsigned long lotSize = LOT_SIZE;
+    // Net ETF position market making quotes into at most, in lots
+    long makingAllowance = POSITION_LIMIT;
+    // Minimum position imbalance before a price adjustment is made
+    long minPositionImbalance = 50;
+    // Price adjustment in ticks per lot of imbalance beyond the minimum
+    double centsPerImbalancedShare = 0.2 / LOT_SIZE;
+    // Take ETF/future crosses with IOC orders plus hedges
+    bool arbitrage = true;
+    // Minimum edge per lot after fees for an arbitrage, in cents
+    long arbitrageMinEdge = 0;
+    // Window over which the hedges of market making fills are netted, in
+    // microseconds; 0 nets the fills handled in one reactor turn
+    long hedgeWindowMicros = 0;
+    // Absolute ETF trade flow imbalance at which the flow counts as toxic,
+    // from 0 to 1; 0 never does
+    double toxicImbalance = 0;
+    // While the flow is toxic, added to additionalSpread, in cents
+    unsigned long toxicExtraSpread = TICK_SIZE_IN_CENTS;
+    // While the flow is toxic, the levels quoted on each side at most
+    int toxicClones = 2;
+
+    bool Valid() const {
+        return numClones >= 1 && numClones <= MAX_CLONES && lotSize >= 1 && makingAllowance >= 0
+               && makingAllowance <= POSITION_LIMIT && additionalSpread % TICK_SIZE_IN_CENTS == 0
+               && minPositionImbalance >= 0 && centsPerImbalancedShare >= 0 && arbitrageMinEdge >= 0
+               && hedgeWindowMicros >= 0 && toxicImbalance >= 0 && toxicImbalance <= 1
+               && toxicExtraSpread % TICK_SIZE_IN_CENTS == 0 && toxicClones >= 1;
+    }
+};
+
+#endif //CPPREADY_TRADER_GO_PARAMETERS_H
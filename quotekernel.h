@@ -0,0 +1,121 @@
+#ifndef CPPREADY_TRADER_GO_QUOTEKERNEL_H
+#define CPPREADY_TRADER_GO_QUOTEKERNEL_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <ready_trader_go/types.h>
+
+#include "constants.h"
+#include "parameters.h"
+
+// Pure integer arithmetic behind a quoting pass: inventory skew, front
+// prices and the volume of every ladder level. Nothing here touches orders
+// or the exchange, so it can be checked on its own, see the static_asserts
+// at the end.
+
+// Fixed point scale of the skew per lot
+constexpr long SKEW_SCALE = 1000000;
+
+// Inventory skew in ticks for every position in [-POSITION_LIMIT,
+// POSITION_LIMIT]. Beyond minPositionImbalance lots the quotes move
+// centsPerImbalancedShare ticks per lot against the position, rounded half
+// away from zero. Built at compile time for the default parameters.
+class SkewTable {
+public:
+    constexpr explicit SkewTable(const StrategyParameters& params) : mTicks{} {
+        const long perLot = (long)(params.centsPerImbalancedShare * SKEW_SCALE + 0.5);
+        for (long position = -POSITION_LIMIT; position <= POSITION_LIMIT; position++) {
+            long excess = position >= 0 ? std::max(0L, position - params.minPositionImbalance)
+                                        : std::min(0L, position + params.minPositionImbalance);
+            long magnitude = ((excess < 0 ? -excess : excess) * perLot + SKEW_SCALE / 2) / SKEW_SCALE;
+            mTicks[(size_t)(position + POSITION_LIMIT)] = (std::int32_t)(excess > 0 ? -magnitude : magnitude);
+        }
+    }
+
+    // Positions beyond the limit are skewed like the limit
+    constexpr long Ticks(long position) const {
+        return mTicks[(size_t)(std::clamp(position, -(long)POSITION_LIMIT, (long)POSITION_LIMIT) + POSITION_LIMIT)];
+    }
+
+private:
+    std::array<std::int32_t, 2 * POSITION_LIMIT + 1> mTicks;
+};
+
+inline constexpr SkewTable DEFAULT_SKEW_TABLE{StrategyParameters{}};
+
+struct QuoteFronts {
+    unsigned long bid, ask;
+};
+
+// Best price of each side of our ladder: the future's touch moved by the
+// skew and away by the spread, but never through the other side's touch.
+// A side is 0, not to be quoted, unless both touches are there and its
+// front is a positive price.
+constexpr QuoteFronts QuoteFront(unsigned long bestBid, unsigned long bestAsk, long skewTicks, unsigned long spread) {
+    if (bestBid == 0 || bestAsk == 0)
+        return {0, 0};
+    const long skew = skewTicks * TICK_SIZE_IN_CENTS;
+    const long bid = std::min((long)bestBid + skew - (long)spread, (long)bestAsk);
+    const long ask = std::max((long)bestAsk + skew + (long)spread, (long)bestBid);
+    return {bid > 0 ? (unsigned long)bid : 0, ask > 0 ? (unsigned long)ask : 0};
+}
+
+// Price of the level offset ticks behind the front of one side
+constexpr unsigned long LevelPrice(ReadyTraderGo::Side side, unsigned long frontPrice, int offset) {
+    const unsigned long step = (unsigned long)offset * TICK_SIZE_IN_CENTS;
+    return side == ReadyTraderGo::Side::BUY ? frontPrice - step : frontPrice + step;
+}
+
+using LadderVolumes = std::array<unsigned long, MAX_CLONES>;
+
+// Target volume of every level, front first. resting is the volume of the
+// order resting at each level, 0 where the level is empty. Resting orders
+// keep their volume, front first, as far as the capacity covers it; the
+// ones it does not cover are shrunk. Only what is left once every resting
+// order is counted goes to the empty levels, up to lotSize each, so an
+// insert never relies on an order behind it going away first. Levels past
+// numClones get nothing.
+// In prefix form: a short scan sums the resting volume and counts the
+// empty levels in front of each level, then every level clamps its own
+// share independently of the others, a branch-free pass the compiler can
+// vectorise.
+constexpr LadderVolumes CapVolumes(long capacity, unsigned long lotSize, int numClones, const LadderVolumes& resting) {
+    std::array<long, MAX_CLONES> restingBefore{}, emptyBefore{};
+    long restingTotal = 0, emptyCount = 0;
+    for (size_t i = 0; i < MAX_CLONES; i++) {
+        restingBefore[i] = restingTotal;
+        emptyBefore[i] = emptyCount;
+        restingTotal += (long)resting[i];
+        emptyCount += resting[i] == 0;
+    }
+    const long lot = (long)lotSize;
+    const long left = capacity - restingTotal;
+    // Every element is overwritten, copying avoids a separate zero fill
+    LadderVolumes target = resting;
+    for (size_t i = 0; i < MAX_CLONES; i++) {
+        const long keep = std::clamp(capacity - restingBefore[i], 0L, (long)resting[i]);
+        const long fill = std::clamp(left - emptyBefore[i] * lot, 0L, lot);
+        const long volume = resting[i] != 0 ? keep : fill;
+        target[i] = (unsigned long)volume & (0UL - (unsigned long)((long)i < numClones));
+    }
+    return target;
+}
+
+static_assert(DEFAULT_SKEW_TABLE.Ticks(0) == 0 && DEFAULT_SKEW_TABLE.Ticks(50) == 0 && DEFAULT_SKEW_TABLE.Ticks(-50) == 0);
+static_assert(DEFAULT_SKEW_TABLE.Ticks(POSITION_LIMIT) == -1 && DEFAULT_SKEW_TABLE.Ticks(-POSITION_LIMIT) == 1);
+static_assert(DEFAULT_SKEW_TABLE.Ticks(2 * POSITION_LIMIT) == DEFAULT_SKEW_TABLE.Ticks(POSITION_LIMIT));
+static_assert(QuoteFront(10000, 10100, -1, 100).bid == 9800 && QuoteFront(10000, 10100, -1, 100).ask == 10100);
+static_assert(QuoteFront(10000, 10100, 3, 100).bid == 10100, "bid capped at the future's ask");
+static_assert(QuoteFront(0, 10100, 0, 100).bid == 0 && QuoteFront(0, 10100, 0, 100).ask == 0, "no quotes without a bid");
+static_assert(QuoteFront(10000, 0, 0, 100).bid == 0 && QuoteFront(10000, 0, 0, 100).ask == 0, "no quotes without an ask");
+static_assert(QuoteFront(200, 300, -3, 100).bid == 0 && QuoteFront(200, 300, -3, 100).ask == 200, "no negative bid");
+static_assert(CapVolumes(25, 10, 5, {10, 10, 10, 10, 10})[2] == 5 && CapVolumes(25, 10, 5, {10, 10, 10, 10, 10})[3] == 0);
+static_assert(CapVolumes(25, 10, 5, {3, 10, 10, 10, 10})[2] == 10, "partly filled levels leave room behind them");
+static_assert(CapVolumes(25, 10, 5, {0, 10, 10, 0, 0})[0] == 5, "empty levels only get what resting orders leave");
+static_assert(CapVolumes(20, 10, 5, {0, 10, 10, 0, 0})[0] == 0 && CapVolumes(20, 10, 5, {0, 10, 10, 0, 0})[2] == 10);
+static_assert(CapVolumes(100, 10, 2, {10, 10, 10})[2] == 0);
+
+#endif //CPPREADY_TRADER_GO_QUOTEKERNEL_H
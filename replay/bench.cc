@@ -0,0 +1,384 @@
+// Micro-benchmarks of the strategy hot paths against the stub BaseAutoTrader.
+//
+//   bench [--rounds <n>] [--repeats <n>] [--csv]
+//
+// Each scenario runs a fresh trader on a simulated clock through the same
+// synthetic books, answering every message it sends the way the exchange
+// would, and times the book (including the quoting pass it posts), status
+// and fill handlers separately. The message frequency tracker is timed on
+// its own. Inputs are fixed, so runs of two commits are comparable; the
+// best of --repeats runs is reported. Status and fill handlers are timed
+// call by call, so their figures include reading the clock twice. Cache
+// misses come from perf_event_open and show as "-" where the kernel does
+// not allow it.
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <boost/asio/io_context.hpp>
+
+#include "autotrader.h"
+#include "clock.h"
+#include "eventrecord.h"
+#include "throttle.h"
+
+using namespace ReadyTraderGo;
+
+static std::uint64_t gAllocations = 0;
+
+void* operator new(size_t size)
+{
+    gAllocations++;
+    if (void* memory = std::malloc(size != 0 ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+
+// Last level cache misses of this thread in user space
+class CacheMissCounter {
+public:
+    CacheMissCounter() {
+        perf_event_attr attr{};
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        mFd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~CacheMissCounter() {
+        if (mFd >= 0)
+            close(mFd);
+    }
+
+    bool Available() const { return mFd >= 0; }
+
+    std::uint64_t Read() const {
+        std::uint64_t count = 0;
+        if (mFd >= 0 && read(mFd, &count, sizeof(count)) != sizeof(count))
+            count = 0;
+        return count;
+    }
+
+private:
+    int mFd;
+};
+
+struct Measurement {
+    std::uint64_t ops = 0, nanoseconds = 0, allocations = 0, misses = 0;
+
+    double PerOp(std::uint64_t total) const { return ops != 0 ? (double)total / (double)ops : 0; }
+};
+
+// Accumulates time, allocations and cache misses of the code between
+// Start and Stop. The counters are read outside the timed part.
+class Meter {
+public:
+    bool CountsMisses() const { return mMisses.Available(); }
+
+    void Start() {
+        mStartMisses = mMisses.Read();
+        mStartAllocations = gAllocations;
+        mStart = std::chrono::steady_clock::now();
+    }
+
+    void Stop(Measurement& measurement, std::uint64_t ops) {
+        auto elapsed = std::chrono::steady_clock::now() - mStart;
+        measurement.allocations += gAllocations - mStartAllocations;
+        measurement.misses += mMisses.Read() - mStartMisses;
+        measurement.nanoseconds += (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        measurement.ops += ops;
+    }
+
+private:
+    CacheMissCounter mMisses;
+    std::uint64_t mStartMisses = 0, mStartAllocations = 0;
+    std::chrono::steady_clock::time_point mStart;
+};
+
+using Levels = std::array<unsigned long, TOP_LEVEL_COUNT>;
+
+struct Book {
+    Levels askPrices, askVolumes, bidPrices, bidVolumes;
+};
+
+// A book one tick wide around mid, volume on every level
+static Book MakeBook(unsigned long mid, unsigned long volume)
+{
+    Book book;
+    for (size_t i = 0; i < TOP_LEVEL_COUNT; i++) {
+        book.bidPrices[i] = mid - (i + 1) * TICK_SIZE_IN_CENTS;
+        book.askPrices[i] = mid + (i + 1) * TICK_SIZE_IN_CENTS;
+        book.askVolumes[i] = book.bidVolumes[i] = volume;
+    }
+    return book;
+}
+
+enum class Scenario { STATIC, TRENDING, CROSSING, FILLS };
+
+struct ScenarioResult {
+    Measurement book, status, fill;
+};
+
+// One trader and the exchange side of it: every message is acknowledged,
+// FAK inserts fill completely, hedges fill at the mid and resting orders
+// are remembered so that the fills scenario can trade against them
+class TraderBench {
+public:
+    TraderBench(Meter& meter, ScenarioResult& result) : mMeter(meter), mResult(result), mTrader(mContext, mClock) {
+        mPending.reserve(1024);
+        mResting.reserve(MAX_TRACKED_ORDERS);
+    }
+
+    void Run(Scenario scenario, int rounds) {
+        constexpr unsigned long MID = 10000 * TICK_SIZE_IN_CENTS;
+        for (int round = 0; round < rounds; round++) {
+            mClock.Advance(boost::posix_time::milliseconds(250));
+            mTrader.FlushHedgesIfDue();
+            mTrader.Throttle().Drain();
+            Answer();
+
+            unsigned long mid = MID;
+            unsigned long etfMid = MID;
+            if (scenario == Scenario::TRENDING) {
+                // A tick a book, turning every 64 books
+                const int leg = round % 128;
+                mid = etfMid = MID + (unsigned long)(leg < 64 ? leg : 128 - leg) * TICK_SIZE_IN_CENTS;
+            } else if (scenario == Scenario::CROSSING && round % 2 == 1) {
+                // ETF asks well below the future's bids, then its bids well
+                // above the future's asks, so the position swings back
+                etfMid = round % 4 == 1 ? MID - 6 * TICK_SIZE_IN_CENTS : MID + 6 * TICK_SIZE_IN_CENTS;
+            }
+            const unsigned long etfVolume = scenario == Scenario::CROSSING ? 10 : 100;
+            const Book future = MakeBook(mid, 100);
+            const Book etf = MakeBook(etfMid, etfVolume);
+            const unsigned long sequence = (unsigned long)round + 1;
+
+            mMeter.Start();
+            mTrader.OrderBookMessageHandler(FUT, sequence, future.askPrices, future.askVolumes, future.bidPrices,
+                                            future.bidVolumes);
+            mTrader.OrderBookMessageHandler(ETF, sequence, etf.askPrices, etf.askVolumes, etf.bidPrices, etf.bidVolumes);
+            mContext.restart();
+            mContext.poll();
+            mMeter.Stop(mResult.book, 2);
+            Answer();
+
+            if (scenario == Scenario::FILLS) {
+                // A lot off every resting order of one side, alternating so
+                // the position stays inside the limit
+                const Side side = round % 2 == 0 ? Side::BUY : Side::SELL;
+                for (size_t i = mResting.size(); i-- != 0;) {
+                    Resting& order = mResting[i];
+                    if (order.side != side)
+                        continue;
+                    mMeter.Start();
+                    mTrader.OrderFilledMessageHandler(order.id, order.price, 1);
+                    mMeter.Stop(mResult.fill, 1);
+                    order.volume--;
+                    Status(order.id, 1, order.volume);
+                    if (order.volume == 0)
+                        Remove(&order);
+                }
+                mContext.restart();
+                mContext.poll();
+                Answer();
+            }
+        }
+    }
+
+private:
+    struct Resting {
+        unsigned long id, price, volume;
+        Side side;
+    };
+
+    // Answers everything sent so far, and whatever the answers trigger
+    void Answer() {
+        while (!mTrader.Sent().empty()) {
+            mPending.assign(mTrader.Sent().begin(), mTrader.Sent().end());
+            mTrader.ClearSent();
+            for (const EventRecord& record : mPending)
+                AnswerOne(record);
+            mContext.restart();
+            mContext.poll();
+            mTrader.FlushHedgesIfDue();
+            mTrader.Throttle().Drain();
+        }
+    }
+
+    void AnswerOne(const EventRecord& record) {
+        switch (record.type) {
+        case EventType::SEND_INSERT:
+            if ((Lifespan)record.lifespan == Lifespan::FILL_AND_KILL) {
+                mMeter.Start();
+                mTrader.OrderFilledMessageHandler(record.id, record.order.price, record.order.volume);
+                mMeter.Stop(mResult.fill, 1);
+                Status(record.id, record.order.volume, 0);
+            } else {
+                mResting.push_back(Resting{record.id, record.order.price, record.order.volume, (Side)record.side});
+                Status(record.id, 0, record.order.volume);
+            }
+            break;
+        case EventType::SEND_AMEND:
+            if (Resting* order = Find(record.id)) {
+                order->volume = std::min(order->volume, record.order.volume);
+                Status(record.id, 0, order->volume);
+                if (order->volume == 0)
+                    Remove(order);
+            }
+            break;
+        case EventType::SEND_CANCEL:
+            if (Resting* order = Find(record.id)) {
+                Remove(order);
+                Status(record.id, 0, 0);
+            }
+            break;
+        case EventType::SEND_HEDGE:
+            mTrader.HedgeFilledMessageHandler(record.id, 10000 * TICK_SIZE_IN_CENTS, record.order.volume);
+            break;
+        default:
+            break;
+        }
+    }
+
+    void Status(unsigned long id, unsigned long fillVolume, unsigned long remainingVolume) {
+        mMeter.Start();
+        mTrader.OrderStatusMessageHandler(id, fillVolume, remainingVolume, 0);
+        mMeter.Stop(mResult.status, 1);
+    }
+
+    Resting* Find(unsigned long id) {
+        for (Resting& order : mResting)
+            if (order.id == id)
+                return &order;
+        return nullptr;
+    }
+
+    void Remove(Resting* order) {
+        *order = mResting.back();
+        mResting.pop_back();
+    }
+
+    Meter& mMeter;
+    ScenarioResult& mResult;
+    boost::asio::io_context mContext;
+    SimulatedClock mClock;
+    AutoTrader mTrader;
+    std::vector<EventRecord> mPending;
+    std::vector<Resting> mResting;
+};
+
+// Sink the tracker results go to, so the loops are not optimised away
+static volatile long gSink;
+
+static void BenchTracker(Meter& meter, int ops, Measurement& note, Measurement& allowed)
+{
+    // A message every 10 ms keeps the window at half the limit
+    MessageFrequencyTracker tracker;
+    ptime now(boost::gregorian::date(2023, 1, 1));
+    const time_duration step = boost::posix_time::milliseconds(10);
+    meter.Start();
+    for (int i = 0; i < ops; i++) {
+        now += step;
+        tracker.NoteMessage(now);
+    }
+    meter.Stop(note, (std::uint64_t)ops);
+
+    long total = 0;
+    meter.Start();
+    for (int i = 0; i < ops; i++) {
+        now += step;
+        total += tracker.GetNewOrdersAllowed(now, i % 16);
+    }
+    meter.Stop(allowed, (std::uint64_t)ops);
+    gSink = total;
+}
+
+struct Row {
+    std::string name;
+    Measurement best;
+};
+
+// Keeps the fastest of the repeats
+static void Keep(std::vector<Row>& rows, const std::string& name, const Measurement& measurement)
+{
+    for (Row& row : rows) {
+        if (row.name != name)
+            continue;
+        if (measurement.PerOp(measurement.nanoseconds) < row.best.PerOp(row.best.nanoseconds))
+            row.best = measurement;
+        return;
+    }
+    rows.push_back(Row{name, measurement});
+}
+
+int main(int argc, char* argv[])
+{
+    int rounds = 2000, repeats = 5;
+    bool csv = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--rounds") == 0 && i + 1 < argc)
+            rounds = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--repeats") == 0 && i + 1 < argc)
+            repeats = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--csv") == 0)
+            csv = true;
+        else {
+            std::fprintf(stderr, "usage: %s [--rounds <n>] [--repeats <n>] [--csv]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    static const std::pair<Scenario, const char*> scenarios[] = {
+        {Scenario::STATIC, "static"}, {Scenario::TRENDING, "trending"},
+        {Scenario::CROSSING, "crossing"}, {Scenario::FILLS, "fills"}};
+
+    Meter meter;
+    std::vector<Row> rows;
+    for (int repeat = 0; repeat < repeats; repeat++) {
+        for (const auto& [scenario, name] : scenarios) {
+            ScenarioResult result;
+            TraderBench bench(meter, result);
+            bench.Run(scenario, rounds);
+            Keep(rows, std::string(name) + "/book", result.book);
+            Keep(rows, std::string(name) + "/status", result.status);
+            if (result.fill.ops != 0)
+                Keep(rows, std::string(name) + "/fill", result.fill);
+        }
+        Measurement note, allowed;
+        BenchTracker(meter, rounds * 100, note, allowed);
+        Keep(rows, "tracker/note", note);
+        Keep(rows, "tracker/allowed", allowed);
+    }
+
+    if (csv)
+        std::printf("benchmark,ops,ns_per_op,allocs_per_op,misses_per_op\n");
+    else
+        std::printf("%-18s %9s %9s %10s %10s\n", "benchmark", "ops", "ns/op", "allocs/op", "misses/op");
+    for (const Row& row : rows) {
+        const Measurement& m = row.best;
+        char misses[32] = "-";
+        if (meter.CountsMisses())
+            std::snprintf(misses, sizeof(misses), "%.2f", m.PerOp(m.misses));
+        if (csv)
+            std::printf("%s,%llu,%.1f,%.2f,%s\n", row.name.c_str(), (unsigned long long)m.ops, m.PerOp(m.nanoseconds),
+                        m.PerOp(m.allocations), misses);
+        else
+            std::printf("%-18s %9llu %9.1f %10.2f %10s\n", row.name.c_str(), (unsigned long long)m.ops,
+                        m.PerOp(m.nanoseconds), m.PerOp(m.allocations), misses);
+    }
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Decodes an event file, e.g. a journal written by AutoTrader, to text.
+//
+//   decode <event file> [--csv]
+//
+// Records are printed in stream order, one per line, either readable or as
+// CSV with one column per field. Book levels are joined with ';' in CSV.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "clock.h"
+#include "eventrecord.h"
+
+namespace
+{
+
+const char* SideName(std::uint8_t side) { return side == (std::uint8_t)ReadyTraderGo::Side::BUY ? "BUY" : "SELL"; }
+
+const char* LifespanName(std::uint8_t lifespan)
+{
+    return lifespan == (std::uint8_t)ReadyTraderGo::Lifespan::GOOD_FOR_DAY ? "GFD" : "FAK";
+}
+
+const char* InstrumentName(std::uint8_t instrument)
+{
+    return instrument == (std::uint8_t)ReadyTraderGo::Instrument::ETF ? "ETF" : "FUTURE";
+}
+
+std::string Levels(const std::array<std::uint32_t, EventRecord::LEVELS>& levels, char separator)
+{
+    std::string out;
+    for (size_t i = 0; i < EventRecord::LEVELS; i++) {
+        if (i != 0)
+            out += separator;
+        out += std::to_string(levels[i]);
+    }
+    return out;
+}
+
+std::string Text(const EventRecord& record) { return std::string(record.text, strnlen(record.text, EventRecord::TEXT_LENGTH)); }
+
+void PrintText(const EventRecord& record)
+{
+    std::string time = boost::posix_time::to_iso_extended_string(FromEventTime(record.timestamp));
+    std::printf("%8llu %s %-13s ", (unsigned long long)record.sequence, time.c_str(), EventTypeName(record.type));
+    switch (record.type) {
+    case EventType::DISCONNECT:
+        break;
+    case EventType::ERROR:
+        std::printf("order %llu: %s", (unsigned long long)record.id, Text(record).c_str());
+        break;
+    case EventType::ORDER_BOOK:
+    case EventType::TRADE_TICKS:
+        std::printf("%s seq %llu ask %s x %s bid %s x %s", InstrumentName(record.instrument),
+                    (unsigned long long)record.id, Levels(record.book.askPrices, ',').c_str(),
+                    Levels(record.book.askVolumes, ',').c_str(), Levels(record.book.bidPrices, ',').c_str(),
+                    Levels(record.book.bidVolumes, ',').c_str());
+        break;
+    case EventType::ORDER_STATUS:
+        std::printf("order %llu filled %llu remaining %llu fees %lld", (unsigned long long)record.id,
+                    (unsigned long long)record.order.price, (unsigned long long)record.order.volume,
+                    (long long)record.order.fees);
+        break;
+    case EventType::SEND_CANCEL:
+        std::printf("order %llu", (unsigned long long)record.id);
+        break;
+    case EventType::SEND_AMEND:
+        std::printf("order %llu volume %llu", (unsigned long long)record.id, (unsigned long long)record.order.volume);
+        break;
+    case EventType::SEND_HEDGE:
+    case EventType::SEND_INSERT:
+        std::printf("order %llu %s %llu @ %llu %s", (unsigned long long)record.id, SideName(record.side),
+                    (unsigned long long)record.order.volume, (unsigned long long)record.order.price,
+                    LifespanName(record.lifespan));
+        break;
+    default:
+        // HEDGE_FILLED, ORDER_FILLED
+        std::printf("order %llu %llu @ %llu", (unsigned long long)record.id, (unsigned long long)record.order.volume,
+                    (unsigned long long)record.order.price);
+        break;
+    }
+    std::printf("\n");
+}
+
+void PrintCsvHeader()
+{
+    std::printf("sequence,timestamp,type,id,instrument,side,lifespan,price,volume,fees,"
+                "ask_prices,ask_volumes,bid_prices,bid_volumes,text\n");
+}
+
+void PrintCsv(const EventRecord& record)
+{
+    std::printf("%llu,%lld,%s,%llu,", (unsigned long long)record.sequence, (long long)record.timestamp,
+                EventTypeName(record.type), (unsigned long long)record.id);
+    switch (record.type) {
+    case EventType::ORDER_BOOK:
+    case EventType::TRADE_TICKS:
+        std::printf("%s,,,,,,%s,%s,%s,%s,", InstrumentName(record.instrument), Levels(record.book.askPrices, ';').c_str(),
+                    Levels(record.book.askVolumes, ';').c_str(), Levels(record.book.bidPrices, ';').c_str(),
+                    Levels(record.book.bidVolumes, ';').c_str());
+        break;
+    case EventType::ERROR: {
+        // Quote the message, doubling any quotes inside it
+        std::string text;
+        for (char c : Text(record))
+            text += c == '"' ? std::string("\"\"") : std::string(1, c);
+        std::printf(",,,,,,,,,,\"%s\"", text.c_str());
+        break;
+    }
+    case EventType::DISCONNECT:
+        std::printf(",,,,,,,,,,");
+        break;
+    default:
+        if (record.type == EventType::SEND_HEDGE || record.type == EventType::SEND_INSERT)
+            std::printf(",%s,%s,", SideName(record.side), LifespanName(record.lifespan));
+        else
+            std::printf(",,,");
+        std::printf("%llu,%llu,%lld,,,,,", (unsigned long long)record.order.price,
+                    (unsigned long long)record.order.volume, (long long)record.order.fees);
+        break;
+    }
+    std::printf("\n");
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    std::string inputPath;
+    bool csv = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--csv") == 0)
+            csv = true;
+        else if (inputPath.empty())
+            inputPath = argv[i];
+    }
+    if (inputPath.empty()) {
+        std::fprintf(stderr, "usage: %s <event file> [--csv]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<EventRecord> records;
+    if (!ReadEventFile(inputPath, records)) {
+        std::fprintf(stderr, "cannot read event file %s\n", inputPath.c_str());
+        return 1;
+    }
+
+    if (csv)
+        PrintCsvHeader();
+    for (const EventRecord& record : records) {
+        if (csv)
+            PrintCsv(record);
+        else
+            PrintText(record);
+    }
+    return 0;
+}
@@ -0,0 +1,333 @@
+#ifndef CPPREADY_TRADER_GO_EXCHANGE_H
+#define CPPREADY_TRADER_GO_EXCHANGE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+
+#include "constants.h"
+#include "eventrecord.h"
+#include "replayer.h"
+
+struct ExchangeStats {
+    unsigned long inserts = 0, amends = 0, cancels = 0, hedges = 0;
+    unsigned long rejected = 0;           // errors sent back for orders
+    unsigned long frequencyBreaches = 0;  // messages refused for the rate limit
+    unsigned long positionBreaches = 0;   // inserts refused for the position limit
+    unsigned long amendKills = 0;         // amends to no more than had traded, taking the order off
+    unsigned long makerVolume = 0, takerVolume = 0;
+    unsigned long unmatchedEvents = 0;    // messages for orders the exchange does not know
+};
+
+// In-process stand-in for the matching engine. The background market is a
+// sequence of ORDER_BOOK/TRADE_TICKS snapshots (recorded or synthetic)
+// which the exchange owns; the trader's ETF orders rest on top of it and
+// are matched against it:
+//  - marketable inserts trade immediately against the snapshot (taker fee),
+//  - resting orders fill when trade ticks print at or through their price
+//    or when the snapshot crosses them (maker fee),
+//  - hedges fill in full against the FUTURE snapshot at its average price.
+// POSITION_LIMIT and MAX_MESSAGE_FREQ are enforced the way the exchange
+// does, by rejecting the offending message with an error. All responses go
+// back through the Replayer, so the loop is synchronous and deterministic.
+class LocalExchange {
+public:
+    explicit LocalExchange(Replayer& replayer) : mReplayer(replayer) {}
+
+    // Applies one background market event at its timestamp and delivers it
+    // to the trader, then runs the loop until the trader is quiet again
+    void OnMarket(const EventRecord& record) {
+        mReplayer.AdvanceTo(FromEventTime(record.timestamp));
+        Pump();
+
+        if (record.type == EventType::ORDER_BOOK) {
+            mBooks[record.instrument] = record.book;
+            if (record.instrument == (std::uint8_t)ETF)
+                MatchCrossedBook();
+        } else if (record.type == EventType::TRADE_TICKS && record.instrument == (std::uint8_t)ETF) {
+            MatchTradeTicks(record.book);
+        }
+        Pump();
+
+        if (IsInbound(record.type) && record.type != EventType::ERROR && record.type != EventType::DISCONNECT)
+            Respond(record);
+        Pump();
+    }
+
+    // Processes everything the trader sent and delivers the responses,
+    // which may in turn make the trader send more
+    void Pump() {
+        for (;;) {
+            const std::vector<EventRecord>& outbound = mReplayer.Outbound();
+            if (mProcessed < outbound.size()) {
+                EventRecord sent = outbound[mProcessed++];
+                Process(sent);
+            } else if (!mResponses.empty()) {
+                EventRecord response = mResponses.front();
+                mResponses.pop_front();
+                mReplayer.Deliver(response);
+            } else {
+                break;
+            }
+        }
+    }
+
+    const ExchangeStats& Stats() const { return mStats; }
+    long EtfPosition() const { return mEtfPosition; }
+
+private:
+    struct RestingOrder {
+        ReadyTraderGo::Side side;
+        unsigned long price, volume, remaining, filled;
+        long fees;
+    };
+
+    void Process(const EventRecord& sent) {
+        ptime now = FromEventTime(sent.timestamp);
+        if (!NoteMessage(now)) {
+            mStats.frequencyBreaches++;
+            Error(sent.id, "order rejected: message frequency limit exceeded");
+            return;
+        }
+        switch (sent.type) {
+        case EventType::SEND_INSERT:
+            Insert(sent);
+            break;
+        case EventType::SEND_AMEND:
+            Amend(sent.id, sent.order.volume);
+            break;
+        case EventType::SEND_CANCEL:
+            Cancel(sent.id);
+            break;
+        case EventType::SEND_HEDGE:
+            Hedge(sent);
+            break;
+        default:
+            break;
+        }
+    }
+
+    bool NoteMessage(ptime now) {
+        while (!mMessageTimes.empty() && now - mMessageTimes.front() >= boost::posix_time::seconds(1))
+            mMessageTimes.pop_front();
+        if (mMessageTimes.size() >= MAX_MESSAGE_FREQ)
+            return false;
+        mMessageTimes.push_back(now);
+        return true;
+    }
+
+    void Insert(const EventRecord& sent) {
+        mStats.inserts++;
+        auto side = (ReadyTraderGo::Side)sent.side;
+        unsigned long price = sent.order.price, volume = sent.order.volume;
+        if (volume == 0 || price == 0 || price % TICK_SIZE_IN_CENTS != 0 || mOrders.count(sent.id) != 0) {
+            Error(sent.id, "order rejected: invalid order");
+            return;
+        }
+        // Worst case position if every active order on this side filled
+        long exposure = (long)volume;
+        for (auto& entry : mOrders)
+            if (entry.second.side == side)
+                exposure += (long)entry.second.remaining;
+        long signedPosition = side == ReadyTraderGo::Side::BUY ? mEtfPosition : -mEtfPosition;
+        if (signedPosition + exposure > POSITION_LIMIT) {
+            mStats.positionBreaches++;
+            Error(sent.id, "order rejected: in breach of position limit");
+            return;
+        }
+
+        RestingOrder& order = mOrders[sent.id] = RestingOrder{side, price, volume, volume, 0, 0};
+
+        // Trade against the background book as a taker
+        EventRecord::BookFields& book = mBooks[(size_t)ETF];
+        auto& prices = side == ReadyTraderGo::Side::BUY ? book.askPrices : book.bidPrices;
+        auto& volumes = side == ReadyTraderGo::Side::BUY ? book.askVolumes : book.bidVolumes;
+        for (size_t level = 0; level < EventRecord::LEVELS && order.remaining != 0; level++) {
+            if (prices[level] == 0 || volumes[level] == 0 || !Marketable(side, price, prices[level]))
+                continue;
+            unsigned long traded = std::min<unsigned long>(order.remaining, volumes[level]);
+            volumes[level] -= (std::uint32_t)traded;
+            Fill(sent.id, order, prices[level], traded, TAKER_FEE);
+            mStats.takerVolume += traded;
+        }
+
+        if ((ReadyTraderGo::Lifespan)sent.lifespan == ReadyTraderGo::Lifespan::FILL_AND_KILL)
+            order.remaining = 0;
+        Status(sent.id, order);
+        if (order.remaining == 0)
+            mOrders.erase(sent.id);
+    }
+
+    void Amend(unsigned long id, unsigned long volume) {
+        mStats.amends++;
+        auto it = mOrders.find(id);
+        if (it == mOrders.end()) {
+            mStats.unmatchedEvents++;
+            return;
+        }
+        // The new volume is the order's total volume including what traded
+        RestingOrder& order = it->second;
+        unsigned long filled = order.filled;
+        if (volume > order.volume) {
+            Error(id, "order rejected: amend can only reduce volume");
+            return;
+        }
+        order.volume = volume;
+        order.remaining = volume > filled ? volume - filled : 0;
+        if (order.remaining == 0)
+            mStats.amendKills++;
+        Status(id, order);
+        if (order.remaining == 0)
+            mOrders.erase(it);
+    }
+
+    void Cancel(unsigned long id) {
+        mStats.cancels++;
+        auto it = mOrders.find(id);
+        if (it == mOrders.end()) {
+            // Already filled or cancelled, the exchange ignores it
+            mStats.unmatchedEvents++;
+            return;
+        }
+        it->second.remaining = 0;
+        Status(id, it->second);
+        mOrders.erase(it);
+    }
+
+    void Hedge(const EventRecord& sent) {
+        mStats.hedges++;
+        auto side = (ReadyTraderGo::Side)sent.side;
+        const EventRecord::BookFields& book = mBooks[(size_t)FUT];
+        const auto& prices = side == ReadyTraderGo::Side::BUY ? book.askPrices : book.bidPrices;
+        const auto& volumes = side == ReadyTraderGo::Side::BUY ? book.askVolumes : book.bidVolumes;
+
+        unsigned long remaining = sent.order.volume, notional = 0, lastPrice = 0;
+        for (size_t level = 0; level < EventRecord::LEVELS && remaining != 0; level++) {
+            if (prices[level] == 0 || !Marketable(side, sent.order.price, prices[level]))
+                break;
+            unsigned long traded = std::min<unsigned long>(remaining, volumes[level]);
+            notional += traded * prices[level];
+            remaining -= traded;
+            lastPrice = prices[level];
+        }
+        // Hedges are always filled in full, the rest goes at the deepest level seen
+        if (lastPrice != 0) {
+            notional += remaining * lastPrice;
+            remaining = 0;
+        }
+        unsigned long volume = sent.order.volume - remaining;
+        unsigned long price = volume == 0 ? 0 : (unsigned long)std::lround((double)notional / (double)volume);
+        EventRecord response = Record(EventType::HEDGE_FILLED, sent.id);
+        response.order.price = price;
+        response.order.volume = volume;
+        mResponses.push_back(response);
+    }
+
+    // Background ask at or below our bid (or bid at or above our ask)
+    void MatchCrossedBook() {
+        EventRecord::BookFields& book = mBooks[(size_t)ETF];
+        MatchAgainst(ReadyTraderGo::Side::BUY, book.askPrices, book.askVolumes);
+        MatchAgainst(ReadyTraderGo::Side::SELL, book.bidPrices, book.bidVolumes);
+    }
+
+    // Sellers hitting bids fill our bids at or above the traded price first,
+    // buyers lifting asks fill our asks at or below it
+    void MatchTradeTicks(EventRecord::BookFields ticks) {
+        MatchAgainst(ReadyTraderGo::Side::BUY, ticks.bidPrices, ticks.bidVolumes);
+        MatchAgainst(ReadyTraderGo::Side::SELL, ticks.askPrices, ticks.askVolumes);
+    }
+
+    void MatchAgainst(ReadyTraderGo::Side side, const std::array<std::uint32_t, EventRecord::LEVELS>& prices,
+                      std::array<std::uint32_t, EventRecord::LEVELS>& volumes) {
+        for (size_t level = 0; level < EventRecord::LEVELS; level++) {
+            if (prices[level] == 0)
+                continue;
+            // Best priced orders first, then time priority by id
+            for (unsigned long id : Priority(side)) {
+                if (volumes[level] == 0)
+                    break;
+                RestingOrder& order = mOrders[id];
+                if (!Marketable(side, order.price, prices[level]))
+                    continue;
+                unsigned long traded = std::min<unsigned long>(order.remaining, volumes[level]);
+                volumes[level] -= (std::uint32_t)traded;
+                Fill(id, order, order.price, traded, MAKER_FEE);
+                mStats.makerVolume += traded;
+                Status(id, order);
+                if (order.remaining == 0)
+                    mOrders.erase(id);
+            }
+        }
+    }
+
+    std::vector<unsigned long> Priority(ReadyTraderGo::Side side) const {
+        std::vector<std::pair<unsigned long, unsigned long>> ranked;
+        for (auto& entry : mOrders)
+            if (entry.second.side == side)
+                ranked.emplace_back(entry.second.price, entry.first);
+        std::sort(ranked.begin(), ranked.end(), [side](const auto& a, const auto& b) {
+            if (a.first != b.first)
+                return side == ReadyTraderGo::Side::BUY ? a.first > b.first : a.first < b.first;
+            return a.second < b.second;
+        });
+        std::vector<unsigned long> ids;
+        for (auto& entry : ranked)
+            ids.push_back(entry.second);
+        return ids;
+    }
+
+    static bool Marketable(ReadyTraderGo::Side side, unsigned long limit, unsigned long price) {
+        return side == ReadyTraderGo::Side::BUY ? price <= limit : price >= limit;
+    }
+
+    void Fill(unsigned long id, RestingOrder& order, unsigned long price, unsigned long volume, double feeRate) {
+        order.remaining -= volume;
+        order.filled += volume;
+        order.fees += (long)std::lround((double)price * (double)volume * feeRate);
+        mEtfPosition += order.side == ReadyTraderGo::Side::BUY ? (long)volume : -(long)volume;
+        EventRecord response = Record(EventType::ORDER_FILLED, id);
+        response.order.price = price;
+        response.order.volume = volume;
+        mResponses.push_back(response);
+    }
+
+    void Status(unsigned long id, const RestingOrder& order) {
+        EventRecord response = Record(EventType::ORDER_STATUS, id);
+        response.order.price = order.filled;
+        response.order.volume = order.remaining;
+        response.order.fees = order.fees;
+        mResponses.push_back(response);
+    }
+
+    void Error(unsigned long id, const char* message) {
+        mStats.rejected++;
+        EventRecord response = Record(EventType::ERROR, id);
+        std::strncpy(response.text, message, EventRecord::TEXT_LENGTH - 1);
+        mResponses.push_back(response);
+    }
+
+    EventRecord Record(EventType type, unsigned long id) const {
+        EventRecord record{};
+        record.type = type;
+        record.id = id;
+        record.timestamp = ToEventTime(mReplayer.Now());
+        return record;
+    }
+
+    void Respond(const EventRecord& record) { mResponses.push_back(record); }
+
+    Replayer& mReplayer;
+    ExchangeStats mStats;
+    std::array<EventRecord::BookFields, 2> mBooks{};
+    std::map<unsigned long, RestingOrder> mOrders;
+    std::deque<ptime> mMessageTimes;
+    std::deque<EventRecord> mResponses;
+    size_t mProcessed = 0;
+    long mEtfPosition = 0;
+};
+
+#endif //CPPREADY_TRADER_GO_EXCHANGE_H
@@ -0,0 +1,63 @@
+// Offline replay of a recorded session through AutoTrader.
+//
+//   replay <session file> [--out <file>]
+//
+// Inbound records of the session are delivered to the trader in order on a
+// simulated clock, so a replay runs as fast as the handlers allow and
+// produces the same outbound stream every time. Outbound records in the
+// input (e.g. from a journal) are ignored; the messages the trader sends
+// during the replay can be written to --out in the same format.
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "autotrader.h"
+#include "eventrecord.h"
+#include "replayer.h"
+
+int main(int argc, char* argv[])
+{
+    std::string inputPath, outputPath;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            outputPath = argv[++i];
+        else if (inputPath.empty())
+            inputPath = argv[i];
+    }
+    if (inputPath.empty()) {
+        std::fprintf(stderr, "usage: %s <session file> [--out <file>]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<EventRecord> session;
+    if (!ReadEventFile(inputPath, session)) {
+        std::fprintf(stderr, "cannot read session file %s\n", inputPath.c_str());
+        return 1;
+    }
+
+    boost::asio::io_context context;
+    SimulatedClock clock(session.empty() ? ptime(boost::gregorian::date(2023, 1, 1)) : FromEventTime(session.front().timestamp));
+    AutoTrader trader(context, clock);
+    Replayer replayer(context, trader, clock);
+
+    size_t delivered = 0;
+    for (const EventRecord& record : session) {
+        if (IsInbound(record.type)) {
+            replayer.Deliver(record);
+            delivered++;
+        }
+    }
+    replayer.Finish();
+
+    std::printf("replayed %zu inbound records\n", delivered);
+    PrintReport(stdout, trader, replayer);
+
+    if (!outputPath.empty() && !WriteEventFile(outputPath, replayer.Outbound())) {
+        std::fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+        return 1;
+    }
+    return 0;
+}
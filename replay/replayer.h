@@ -0,0 +1,292 @@
+#ifndef CPPREADY_TRADER_GO_REPLAYER_H
+#define CPPREADY_TRADER_GO_REPLAYER_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "autotrader.h"
+#include "eventrecord.h"
+
+// Invokes the handler an inbound record stands for
+inline void DeliverEvent(ReadyTraderGo::BaseAutoTrader& trader, const EventRecord& record) {
+    using namespace ReadyTraderGo;
+    std::array<unsigned long, TOP_LEVEL_COUNT> askPrices, askVolumes, bidPrices, bidVolumes;
+    switch (record.type) {
+    case EventType::DISCONNECT:
+        trader.DisconnectHandler();
+        break;
+    case EventType::ERROR:
+        trader.ErrorMessageHandler(record.id, std::string(record.text, strnlen(record.text, EventRecord::TEXT_LENGTH)));
+        break;
+    case EventType::HEDGE_FILLED:
+        trader.HedgeFilledMessageHandler(record.id, record.order.price, record.order.volume);
+        break;
+    case EventType::ORDER_BOOK:
+    case EventType::TRADE_TICKS:
+        UnpackLevels(askPrices, record.book.askPrices);
+        UnpackLevels(askVolumes, record.book.askVolumes);
+        UnpackLevels(bidPrices, record.book.bidPrices);
+        UnpackLevels(bidVolumes, record.book.bidVolumes);
+        if (record.type == EventType::ORDER_BOOK)
+            trader.OrderBookMessageHandler((Instrument)record.instrument, record.id, askPrices, askVolumes, bidPrices, bidVolumes);
+        else
+            trader.TradeTicksMessageHandler((Instrument)record.instrument, record.id, askPrices, askVolumes, bidPrices, bidVolumes);
+        break;
+    case EventType::ORDER_FILLED:
+        trader.OrderFilledMessageHandler(record.id, record.order.price, record.order.volume);
+        break;
+    case EventType::ORDER_STATUS:
+        trader.OrderStatusMessageHandler(record.id, record.order.price, record.order.volume, record.order.fees);
+        break;
+    default:
+        break;
+    }
+}
+
+// Latency samples of one handler, in nanoseconds
+class LatencySamples {
+public:
+    void Add(std::uint64_t nanoseconds) { mSamples.push_back(nanoseconds); }
+    size_t Count() const { return mSamples.size(); }
+
+    void Print(std::FILE* out, const char* name) {
+        if (mSamples.empty())
+            return;
+        std::sort(mSamples.begin(), mSamples.end());
+        std::uint64_t total = 0;
+        for (std::uint64_t sample : mSamples)
+            total += sample;
+        std::fprintf(out, "%-14s %9zu %9llu %9llu %9llu %9llu %9llu %9llu\n", name, mSamples.size(),
+                     (unsigned long long)(total / mSamples.size()), (unsigned long long)Percentile(0.5),
+                     (unsigned long long)Percentile(0.9), (unsigned long long)Percentile(0.99),
+                     (unsigned long long)Percentile(0.999), (unsigned long long)mSamples.back());
+    }
+
+    static void PrintHeader(std::FILE* out) {
+        std::fprintf(out, "%-14s %9s %9s %9s %9s %9s %9s %9s\n", "handler (ns)", "count", "mean", "p50", "p90", "p99",
+                     "p99.9", "max");
+    }
+
+private:
+    std::uint64_t Percentile(double q) const { return mSamples[(size_t)(q * (double)(mSamples.size() - 1))]; }
+
+    std::vector<std::uint64_t> mSamples;
+};
+
+// Position and profit bookkeeping from the trader's point of view, marked
+// to the mid price of the last book seen for each instrument
+class Accountant {
+public:
+    void OnOutbound(const EventRecord& record) {
+        if (record.type == EventType::SEND_INSERT)
+            mSides[record.id] = record.side;
+        else if (record.type == EventType::SEND_HEDGE)
+            mSides[record.id] = record.side;
+    }
+
+    void OnInbound(const EventRecord& record) {
+        switch (record.type) {
+        case EventType::ORDER_FILLED:
+            Fill(mEtfPosition, record.id, record.order.price, record.order.volume);
+            break;
+        case EventType::HEDGE_FILLED:
+            Fill(mFuturePosition, record.id, record.order.price, record.order.volume);
+            break;
+        case EventType::ORDER_STATUS:
+            // Fees are reported cumulatively per order
+            mFees += record.order.fees - mOrderFees[record.id];
+            mOrderFees[record.id] = record.order.fees;
+            break;
+        case EventType::ORDER_BOOK:
+            if (record.book.askPrices[0] != 0 && record.book.bidPrices[0] != 0) {
+                long mid = ((long)record.book.askPrices[0] + (long)record.book.bidPrices[0]) / 2;
+                (record.instrument == (std::uint8_t)ETF ? mEtfMid : mFutureMid) = mid;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    long EtfPosition() const { return mEtfPosition; }
+    long FuturePosition() const { return mFuturePosition; }
+    long Fees() const { return mFees; }
+    unsigned long TradedVolume() const { return mTradedVolume; }
+
+    // Profit in cents, after fees
+    long ProfitAndLoss() const { return mCash + mEtfPosition * mEtfMid + mFuturePosition * mFutureMid - mFees; }
+
+private:
+    void Fill(long& position, unsigned long orderId, unsigned long price, unsigned long volume) {
+        auto side = mSides.find(orderId);
+        if (side == mSides.end() || volume == 0)
+            return;
+        long signedVolume = side->second == (std::uint8_t)ReadyTraderGo::Side::BUY ? (long)volume : -(long)volume;
+        position += signedVolume;
+        mCash -= signedVolume * (long)price;
+        mTradedVolume += volume;
+    }
+
+    std::unordered_map<unsigned long, std::uint8_t> mSides;
+    std::unordered_map<unsigned long, long> mOrderFees;
+    long mEtfPosition = 0, mFuturePosition = 0;
+    long mCash = 0, mFees = 0;
+    long mEtfMid = 0, mFutureMid = 0;
+    unsigned long mTradedVolume = 0;
+};
+
+// Drives an AutoTrader built against the stub BaseAutoTrader through a
+// stream of inbound records on a simulated clock. Every message the trader
+// sends is captured, stamped with the simulated time and numbered. Work the
+// trader posts to its io_context is run right after each record, as if
+// every record arrived in a reactor turn of its own.
+class Replayer {
+public:
+    static constexpr size_t EVENT_TYPES = (size_t)EventType::SEND_INSERT + 1;
+
+    Replayer(boost::asio::io_context& context, AutoTrader& trader, SimulatedClock& clock)
+        : mContext(context), mTrader(trader), mClock(clock) {}
+
+    // Advances the simulated clock to the record's time, releasing any
+    // throttled messages and netted hedges that became due on the way, then
+    // handles it
+    void Deliver(const EventRecord& record) {
+        AdvanceTo(FromEventTime(record.timestamp));
+        mAccountant.OnInbound(record);
+
+        auto start = std::chrono::steady_clock::now();
+        DeliverEvent(mTrader, record);
+        Poll();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        mLatencies[(size_t)record.type].Add((std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+
+        CollectSent();
+    }
+
+    // Lets the trader send everything still queued or waiting to be netted
+    void Finish() {
+        ptime next;
+        while (!(next = NextTimer()).is_not_a_date_time()) {
+            mClock.Set(std::max(mClock.Now(), next));
+            RunTimers();
+        }
+    }
+
+    void AdvanceTo(ptime time) {
+        ptime next;
+        while (!(next = NextTimer()).is_not_a_date_time() && next <= time) {
+            mClock.Set(std::max(mClock.Now(), next));
+            RunTimers();
+        }
+        if (time > mClock.Now())
+            mClock.Set(time);
+    }
+
+    ptime Now() const { return mClock.Now(); }
+    const std::vector<EventRecord>& Outbound() const { return mOutbound; }
+    const Accountant& Accounts() const { return mAccountant; }
+    LatencySamples& Latencies(EventType type) { return mLatencies[(size_t)type]; }
+
+    // FNV-1a over the outbound stream, equal across runs iff the trader
+    // behaved identically
+    std::uint64_t Checksum() const {
+        std::uint64_t hash = 0xcbf29ce484222325ULL;
+        auto mix = [&hash](std::uint64_t value) {
+            for (int i = 0; i < 8; i++, value >>= 8)
+                hash = (hash ^ (value & 0xFF)) * 0x100000001b3ULL;
+        };
+        for (const EventRecord& record : mOutbound) {
+            mix((std::uint64_t)record.timestamp);
+            mix((std::uint64_t)record.type | (std::uint64_t)record.side << 8 | (std::uint64_t)record.lifespan << 16);
+            mix(record.id);
+            mix(record.order.price);
+            mix(record.order.volume);
+        }
+        return hash;
+    }
+
+private:
+    // The trader's timers run on the simulated clock, the io_context's
+    // steady_timers would fire in wall clock time
+    ptime NextTimer() {
+        ptime drain = mTrader.Throttle().NextDrainTime(), flush = mTrader.NextHedgeFlush();
+        if (drain.is_not_a_date_time())
+            return flush;
+        return flush.is_not_a_date_time() ? drain : std::min(drain, flush);
+    }
+
+    void RunTimers() {
+        mTrader.FlushHedgesIfDue();
+        mTrader.Throttle().Drain();
+        CollectSent();
+    }
+
+    void Poll() {
+        if (mContext.stopped())
+            mContext.restart();
+        mContext.poll();
+    }
+
+    void CollectSent() {
+        for (const EventRecord& sent : mTrader.Sent()) {
+            EventRecord& record = mOutbound.emplace_back(sent);
+            record.sequence = mOutbound.size() - 1;
+            record.timestamp = ToEventTime(mClock.Now());
+            mAccountant.OnOutbound(record);
+        }
+        mTrader.ClearSent();
+    }
+
+    boost::asio::io_context& mContext;
+    AutoTrader& mTrader;
+    SimulatedClock& mClock;
+    Accountant mAccountant;
+    std::vector<EventRecord> mOutbound;
+    std::array<LatencySamples, EVENT_TYPES> mLatencies;
+};
+
+// Summary shared by the offline tools: outbound message counts, throttle
+// behaviour, handler latencies and the final positions and PnL
+inline void PrintReport(std::FILE* out, AutoTrader& trader, Replayer& replayer) {
+    std::fprintf(out, "%zu outbound messages, checksum %016llx\n", replayer.Outbound().size(),
+                 (unsigned long long)replayer.Checksum());
+
+    std::array<size_t, Replayer::EVENT_TYPES> sent{};
+    for (const EventRecord& record : replayer.Outbound())
+        sent[(size_t)record.type]++;
+    for (EventType type : {EventType::SEND_INSERT, EventType::SEND_AMEND, EventType::SEND_CANCEL, EventType::SEND_HEDGE})
+        std::fprintf(out, "%-14s %9zu\n", EventTypeName(type), sent[(size_t)type]);
+
+    const ThrottleStats& throttle = trader.Throttle().Stats();
+    std::fprintf(out, "throttle: %lu queued, %lu coalesced, %lu withdrawn, max depth %zu, max wait %s\n", throttle.queued,
+                 throttle.coalesced, throttle.withdrawn, throttle.maxQueueDepth,
+                 boost::posix_time::to_simple_string(throttle.maxWait).c_str());
+    const MarketDataStats& marketData = trader.MarketData();
+    const HedgeStats& hedges = trader.Hedges().Stats();
+    std::fprintf(out, "hedging: %lu fills netted into %lu hedges, %lu lots offset, max %lu lots pending, "
+                 "%lu held back\n", hedges.fills, hedges.hedges, hedges.offset, hedges.maxPending, hedges.held);
+    const FlowStats& flow = trader.Flow().Stats(ReadyTraderGo::Instrument::ETF);
+    std::fprintf(out, "ETF flow: VWAP %.1f, imbalance %+.2f, volatility %.5f, %.2f trade ticks per second\n", flow.vwap,
+                 flow.imbalance, flow.volatility, flow.arrivalRate);
+    std::fprintf(out, "market data: %lu stale, %lu gaps, %lu conflated, %lu of %lu quoting passes skipped\n\n",
+                 marketData.stale, marketData.gaps, marketData.conflated, marketData.skipped, marketData.passes);
+
+    LatencySamples::PrintHeader(out);
+    for (size_t type = 0; type < Replayer::EVENT_TYPES; type++)
+        replayer.Latencies((EventType)type).Print(out, EventTypeName((EventType)type));
+
+    const Accountant& accounts = replayer.Accounts();
+    std::fprintf(out, "\nETF position %ld, FUTURE position %ld, traded volume %lu, fees %ld, PnL %ld cents\n",
+                 accounts.EtfPosition(), accounts.FuturePosition(), accounts.TradedVolume(), accounts.Fees(),
+                 accounts.ProfitAndLoss());
+}
+
+#endif //CPPREADY_TRADER_GO_REPLAYER_H
@@ -0,0 +1,104 @@
+// Closed-loop simulation of AutoTrader against the local exchange.
+//
+//   simulate [--session <file>] [--seconds <n>] [--seed <n>] [--crosses <n>]
+//            [--making-allowance <lots>] [--out <file>]
+//
+// The background market comes from the ORDER_BOOK/TRADE_TICKS records of a
+// recorded session, or from a seeded synthetic market running for --seconds
+// of simulated time (a 15 minute session by default); --crosses shocks the
+// synthetic ETF into crossing the future that many steps in a thousand.
+// Arbitrage then moves the net position under the quotes, and with a
+// --making-allowance below the position limit the quotes have to be
+// amended down to it, e.g.
+//   simulate --seed 1 --crosses 100 --making-allowance 60
+//
+// The trader's orders are matched by the LocalExchange and all fills,
+// statuses, hedges and errors are fed back into its handlers. Exits with 3
+// if the exchange rejected any insert for the position limit or an amend
+// took an order off.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "autotrader.h"
+#include "eventrecord.h"
+#include "exchange.h"
+#include "parameters.h"
+#include "replayer.h"
+#include "simulation.h"
+
+int main(int argc, char* argv[])
+{
+    std::string sessionPath, outputPath;
+    long seconds = 900;
+    unsigned long seed = 1;
+    unsigned crosses = 0;
+    StrategyParameters params;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--session") == 0)
+            sessionPath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--seconds") == 0)
+            seconds = std::atol(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--seed") == 0)
+            seed = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--crosses") == 0)
+            crosses = (unsigned)std::strtoul(argv[i + 1], nullptr, 10);
+        else if (std::strcmp(argv[i], "--making-allowance") == 0)
+            params.makingAllowance = std::atol(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--out") == 0)
+            outputPath = argv[i + 1];
+        else {
+            std::fprintf(stderr, "usage: %s [--session <file>] [--seconds <n>] [--seed <n>] [--crosses <n>] "
+                                 "[--making-allowance <lots>] [--out <file>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<EventRecord> session;
+    if (!sessionPath.empty() && !ReadEventFile(sessionPath, session)) {
+        std::fprintf(stderr, "cannot read session file %s\n", sessionPath.c_str());
+        return 1;
+    }
+
+    if (!params.Valid()) {
+        std::fprintf(stderr, "invalid strategy parameters\n");
+        return 2;
+    }
+
+    Simulation simulation(session.empty() ? ptime(boost::gregorian::date(2023, 1, 1)) : FromEventTime(session.front().timestamp),
+                          params);
+    if (!sessionPath.empty())
+        simulation.RunSession(session);
+    else
+        simulation.RunSynthetic(seed, seconds, crosses);
+
+    AutoTrader& trader = simulation.Trader();
+    Replayer& replayer = simulation.Replay();
+    const LocalExchange& exchange = simulation.Exchange();
+    size_t marketEvents = simulation.MarketEvents();
+
+    const ExchangeStats& stats = exchange.Stats();
+    std::printf("simulated %zu market events\n", marketEvents);
+    std::printf("exchange: %lu inserts, %lu amends, %lu cancels, %lu hedges, %lu rejected, %lu rate limit breaches, "
+                "%lu position limit breaches, %lu amends taking the order off, maker volume %lu, taker volume %lu\n",
+                stats.inserts, stats.amends, stats.cancels, stats.hedges, stats.rejected, stats.frequencyBreaches,
+                stats.positionBreaches, stats.amendKills, stats.makerVolume, stats.takerVolume);
+    PrintReport(stdout, trader, replayer);
+
+    if (!outputPath.empty() && !WriteEventFile(outputPath, replayer.Outbound())) {
+        std::fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+        return 1;
+    }
+    // The trader's own checks must keep every insert within the limit, and
+    // amends only ever shrink what is left of an order, never take it off
+    if (stats.positionBreaches != 0 || stats.amendKills != 0) {
+        std::fprintf(stderr, "%lu inserts rejected for the position limit, %lu amends took their order off\n",
+                     stats.positionBreaches, stats.amendKills);
+        return 3;
+    }
+    return 0;
+}
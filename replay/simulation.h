@@ -0,0 +1,66 @@
+#ifndef CPPREADY_TRADER_GO_SIMULATION_H
+#define CPPREADY_TRADER_GO_SIMULATION_H
+
+#include <cstdint>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "autotrader.h"
+#include "eventrecord.h"
+#include "exchange.h"
+#include "parameters.h"
+#include "replayer.h"
+#include "syntheticmarket.h"
+
+// One self-contained closed-loop run: a trader, its simulated clock and
+// io_context, the replayer and the local exchange. Nothing is shared
+// between instances, so independent simulations can run on any thread.
+class Simulation {
+public:
+    Simulation(ptime start, const StrategyParameters& params = StrategyParameters())
+        : mClock(start), mTrader(mContext, mClock, params), mReplayer(mContext, mTrader, mClock), mExchange(mReplayer) {}
+
+    // Uses the ORDER_BOOK and TRADE_TICKS records of a recording as the
+    // background market
+    void RunSession(const std::vector<EventRecord>& session) {
+        for (const EventRecord& record : session)
+            if (record.type == EventType::ORDER_BOOK || record.type == EventType::TRADE_TICKS)
+                OnMarket(record);
+        Finish();
+    }
+
+    // Runs against a seeded synthetic market for the given simulated time
+    void RunSynthetic(std::uint64_t seed, long seconds, unsigned crossesPerMille = 0) {
+        const std::int64_t start = ToEventTime(mClock.Now());
+        SyntheticMarket market(seed, start, crossesPerMille);
+        while (market.Time() - start < seconds * 1000000)
+            market.Step([this](const EventRecord& record) { OnMarket(record); });
+        Finish();
+    }
+
+    size_t MarketEvents() const { return mMarketEvents; }
+    AutoTrader& Trader() { return mTrader; }
+    Replayer& Replay() { return mReplayer; }
+    const LocalExchange& Exchange() const { return mExchange; }
+
+private:
+    void OnMarket(const EventRecord& record) {
+        mExchange.OnMarket(record);
+        mMarketEvents++;
+    }
+
+    void Finish() {
+        mReplayer.Finish();
+        mExchange.Pump();
+    }
+
+    boost::asio::io_context mContext;
+    SimulatedClock mClock;
+    AutoTrader mTrader;
+    Replayer mReplayer;
+    LocalExchange mExchange;
+    size_t mMarketEvents = 0;
+};
+
+#endif //CPPREADY_TRADER_GO_SIMULATION_H
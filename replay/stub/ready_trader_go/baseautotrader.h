@@ -0,0 +1,92 @@
+// Stand-in for the Ready Trader Go library header. There is no exchange
+// connection: handlers are invoked directly by the offline tooling and
+// every Send* call is captured as an EventRecord instead of being sent.
+#ifndef CPPREADY_TRADER_GO_STUB_BASEAUTOTRADER_H
+#define CPPREADY_TRADER_GO_STUB_BASEAUTOTRADER_H
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+
+#include "types.h"
+#include "../../../eventrecord.h"
+
+namespace ReadyTraderGo
+{
+
+class BaseAutoTrader
+{
+public:
+    explicit BaseAutoTrader(boost::asio::io_context& context) : mContext(context)
+    {
+        mSent.reserve(1024);
+    }
+    virtual ~BaseAutoTrader() = default;
+
+    virtual void DisconnectHandler() {}
+    virtual void ErrorMessageHandler(unsigned long clientOrderId, const std::string& errorMessage) {}
+    virtual void HedgeFilledMessageHandler(unsigned long clientOrderId, unsigned long price, unsigned long volume) {}
+    virtual void OrderBookMessageHandler(Instrument instrument,
+                                         unsigned long sequenceNumber,
+                                         const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
+                                         const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
+                                         const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
+                                         const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes) {}
+    virtual void OrderFilledMessageHandler(unsigned long clientOrderId, unsigned long price, unsigned long volume) {}
+    virtual void OrderStatusMessageHandler(unsigned long clientOrderId,
+                                           unsigned long fillVolume,
+                                           unsigned long remainingVolume,
+                                           signed long fees) {}
+    virtual void TradeTicksMessageHandler(Instrument instrument,
+                                          unsigned long sequenceNumber,
+                                          const std::array<unsigned long, TOP_LEVEL_COUNT>& askPrices,
+                                          const std::array<unsigned long, TOP_LEVEL_COUNT>& askVolumes,
+                                          const std::array<unsigned long, TOP_LEVEL_COUNT>& bidPrices,
+                                          const std::array<unsigned long, TOP_LEVEL_COUNT>& bidVolumes) {}
+
+    virtual void SendAmendOrder(unsigned long clientOrderId, unsigned long volume)
+    {
+        Capture(EventType::SEND_AMEND, clientOrderId, Side::SELL, 0, volume, Lifespan::GOOD_FOR_DAY);
+    }
+    virtual void SendCancelOrder(unsigned long clientOrderId)
+    {
+        Capture(EventType::SEND_CANCEL, clientOrderId, Side::SELL, 0, 0, Lifespan::GOOD_FOR_DAY);
+    }
+    virtual void SendHedgeOrder(unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume)
+    {
+        Capture(EventType::SEND_HEDGE, clientOrderId, side, price, volume, Lifespan::FILL_AND_KILL);
+    }
+    virtual void SendInsertOrder(unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume, Lifespan lifespan)
+    {
+        Capture(EventType::SEND_INSERT, clientOrderId, side, price, volume, lifespan);
+    }
+
+    // Messages sent since the last call to ClearSent, timestamp and sequence
+    // are left for the caller to fill in
+    const std::vector<EventRecord>& Sent() const { return mSent; }
+    void ClearSent() { mSent.clear(); }
+
+protected:
+    boost::asio::io_context& mContext;
+
+private:
+    void Capture(EventType type, unsigned long clientOrderId, Side side, unsigned long price, unsigned long volume, Lifespan lifespan)
+    {
+        EventRecord& record = mSent.emplace_back();
+        record.type = type;
+        record.id = clientOrderId;
+        record.side = (std::uint8_t)side;
+        record.lifespan = (std::uint8_t)lifespan;
+        record.order.price = price;
+        record.order.volume = volume;
+        record.order.fees = 0;
+    }
+
+    std::vector<EventRecord> mSent;
+};
+
+}
+
+#endif //CPPREADY_TRADER_GO_STUB_BASEAUTOTRADER_H
@@ -0,0 +1,27 @@
+// Stand-in for the Ready Trader Go library header. Offline runs log to
+// std::clog without channels or severity filtering.
+#ifndef CPPREADY_TRADER_GO_STUB_LOGGING_H
+#define CPPREADY_TRADER_GO_STUB_LOGGING_H
+
+#include <iostream>
+
+namespace ReadyTraderGo
+{
+
+enum class LogLevel
+{
+    LL_DEBUG,
+    LL_INFO,
+    LL_WARNING,
+    LL_ERROR,
+    LL_FATAL
+};
+
+}
+
+#define RTG_INLINE_GLOBAL_LOGGER_WITH_CHANNEL(name, channel) \
+    struct name { static constexpr const char* Channel = channel; };
+
+#define RLOG(logger, level) (std::clog << '[' << logger::Channel << "] ")
+
+#endif //CPPREADY_TRADER_GO_STUB_LOGGING_H
@@ -0,0 +1,47 @@
+// Stand-in for the Ready Trader Go library header, providing just what
+// AutoTrader uses so it can be built and driven offline.
+#ifndef CPPREADY_TRADER_GO_STUB_TYPES_H
+#define CPPREADY_TRADER_GO_STUB_TYPES_H
+
+#include <cstdint>
+#include <ostream>
+
+namespace ReadyTraderGo
+{
+
+constexpr int TOP_LEVEL_COUNT = 5;
+
+constexpr unsigned long MAXIMUM_ASK = 2147483647;
+constexpr unsigned long MINIMUM_BID = 1;
+
+enum class Instrument : std::uint8_t
+{
+    FUTURE,
+    ETF
+};
+
+enum class Lifespan : std::uint8_t
+{
+    FILL_AND_KILL,
+    GOOD_FOR_DAY
+};
+
+enum class Side : std::uint8_t
+{
+    SELL,
+    BUY
+};
+
+inline std::ostream& operator<<(std::ostream& os, Instrument instrument)
+{
+    return os << (instrument == Instrument::FUTURE ? "FUTURE" : "ETF");
+}
+
+inline std::ostream& operator<<(std::ostream& os, Side side)
+{
+    return os << (side == Side::BUY ? "BUY" : "SELL");
+}
+
+}
+
+#endif //CPPREADY_TRADER_GO_STUB_TYPES_H
@@ -0,0 +1,216 @@
+// Parameter sweep over closed-loop simulations.
+//
+//   sweep [--clones 3,5] [--spread 0,1] [--lot 5,10] [--imbalance 30,50]
+//         [--skew 0.01,0.02] [--session <file>]... [--seeds 1,2,3]
+//         [--seconds <n>] [--threads <n>] [--out <csv>] [--top <n>]
+//
+// Every combination of the listed StrategyParameters values (--spread is in
+// ticks) is simulated against every session: each recorded --session plus
+// one synthetic market per --seed. Each run owns its own trader, clock and
+// exchange and runs as one job on a work-stealing pool, so the sweep scales
+// with the number of cores. Results are aggregated per parameter set and
+// ranked by total PnL.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eventrecord.h"
+#include "parameters.h"
+#include "simulation.h"
+#include "workstealing.h"
+
+namespace {
+
+template<typename T, typename Parse>
+std::vector<T> ParseList(const char* text, Parse parse)
+{
+    std::vector<T> values;
+    std::string list(text);
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        if (end > start)
+            values.push_back(parse(list.substr(start, end - start)));
+        start = end + 1;
+    }
+    return values;
+}
+
+struct RunResult {
+    long pnl = 0, fees = 0, finalPosition = 0;
+    unsigned long tradedVolume = 0, messages = 0, rejected = 0, breaches = 0;
+};
+
+struct Ranked {
+    size_t parameterSet;
+    long totalPnl, worstPnl;
+    unsigned long tradedVolume, messages, rejected, breaches;
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+    StrategyParameters defaults;
+    std::vector<int> clones{defaults.numClones};
+    std::vector<unsigned long> spreads{defaults.additionalSpread / TICK_SIZE_IN_CENTS};
+    std::vector<unsigned long> lots{defaults.lotSize};
+    std::vector<long> imbalances{defaults.minPositionImbalance};
+    std::vector<double> skews{defaults.centsPerImbalancedShare};
+    std::vector<std::string> sessionPaths;
+    std::vector<unsigned long> seeds;
+    long seconds = 900;
+    unsigned threads = std::max(1U, std::thread::hardware_concurrency());
+    std::string outputPath;
+    size_t top = 20;
+
+    auto toLong = [](const std::string& s) { return std::atol(s.c_str()); };
+    auto toULong = [](const std::string& s) { return std::strtoul(s.c_str(), nullptr, 10); };
+    auto toDouble = [](const std::string& s) { return std::atof(s.c_str()); };
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* option = argv[i];
+        const char* value = argv[i + 1];
+        if (std::strcmp(option, "--clones") == 0)
+            clones = ParseList<int>(value, toLong);
+        else if (std::strcmp(option, "--spread") == 0)
+            spreads = ParseList<unsigned long>(value, toULong);
+        else if (std::strcmp(option, "--lot") == 0)
+            lots = ParseList<unsigned long>(value, toULong);
+        else if (std::strcmp(option, "--imbalance") == 0)
+            imbalances = ParseList<long>(value, toLong);
+        else if (std::strcmp(option, "--skew") == 0)
+            skews = ParseList<double>(value, toDouble);
+        else if (std::strcmp(option, "--session") == 0)
+            sessionPaths.emplace_back(value);
+        else if (std::strcmp(option, "--seeds") == 0)
+            seeds = ParseList<unsigned long>(value, toULong);
+        else if (std::strcmp(option, "--seconds") == 0)
+            seconds = std::atol(value);
+        else if (std::strcmp(option, "--threads") == 0)
+            threads = (unsigned)std::max(1L, std::atol(value));
+        else if (std::strcmp(option, "--out") == 0)
+            outputPath = value;
+        else if (std::strcmp(option, "--top") == 0)
+            top = (size_t)std::max(1L, std::atol(value));
+        else {
+            std::fprintf(stderr, "unknown option %s\n", option);
+            return 2;
+        }
+    }
+    if (sessionPaths.empty() && seeds.empty())
+        seeds = {1, 2, 3, 4};
+
+    std::vector<std::vector<EventRecord>> sessions(sessionPaths.size());
+    for (size_t i = 0; i < sessionPaths.size(); i++) {
+        if (!ReadEventFile(sessionPaths[i], sessions[i])) {
+            std::fprintf(stderr, "cannot read session file %s\n", sessionPaths[i].c_str());
+            return 1;
+        }
+    }
+
+    std::vector<StrategyParameters> grid;
+    for (int numClones : clones)
+        for (unsigned long spread : spreads)
+            for (unsigned long lotSize : lots)
+                for (long imbalance : imbalances)
+                    for (double skew : skews) {
+                        StrategyParameters params;
+                        params.numClones = numClones;
+                        params.additionalSpread = spread * TICK_SIZE_IN_CENTS;
+                        params.lotSize = lotSize;
+                        params.minPositionImbalance = imbalance;
+                        params.centsPerImbalancedShare = skew;
+                        if (!params.Valid()) {
+                            std::fprintf(stderr, "skipping invalid parameter set clones=%d spread=%lu lot=%lu\n",
+                                         numClones, spread, lotSize);
+                            continue;
+                        }
+                        grid.push_back(params);
+                    }
+
+    // One result slot per (parameter set, session); each job writes only its own
+    const size_t runsPerSet = sessions.size() + seeds.size();
+    std::vector<RunResult> results(grid.size() * runsPerSet);
+    WorkStealingPool pool(threads);
+    for (size_t set = 0; set < grid.size(); set++) {
+        for (size_t run = 0; run < runsPerSet; run++) {
+            pool.Submit([&, set, run] {
+                const std::vector<EventRecord>* session = run < sessions.size() ? &sessions[run] : nullptr;
+                ptime start = session != nullptr && !session->empty() ? FromEventTime(session->front().timestamp)
+                                                                      : ptime(boost::gregorian::date(2023, 1, 1));
+                auto simulation = std::make_unique<Simulation>(start, grid[set]);
+                if (session != nullptr)
+                    simulation->RunSession(*session);
+                else
+                    simulation->RunSynthetic(seeds[run - sessions.size()], seconds);
+
+                const Accountant& accounts = simulation->Replay().Accounts();
+                const ExchangeStats& stats = simulation->Exchange().Stats();
+                RunResult& result = results[set * runsPerSet + run];
+                result.pnl = accounts.ProfitAndLoss();
+                result.fees = accounts.Fees();
+                result.finalPosition = accounts.EtfPosition();
+                result.tradedVolume = accounts.TradedVolume();
+                result.messages = simulation->Replay().Outbound().size();
+                result.rejected = stats.rejected;
+                result.breaches = stats.frequencyBreaches;
+            });
+        }
+    }
+    pool.Run();
+
+    std::vector<Ranked> ranking;
+    for (size_t set = 0; set < grid.size(); set++) {
+        Ranked ranked{set, 0, 0, 0, 0, 0, 0};
+        for (size_t run = 0; run < runsPerSet; run++) {
+            const RunResult& result = results[set * runsPerSet + run];
+            ranked.totalPnl += result.pnl;
+            ranked.worstPnl = run == 0 ? result.pnl : std::min(ranked.worstPnl, result.pnl);
+            ranked.tradedVolume += result.tradedVolume;
+            ranked.messages += result.messages;
+            ranked.rejected += result.rejected;
+            ranked.breaches += result.breaches;
+        }
+        ranking.push_back(ranked);
+    }
+    std::sort(ranking.begin(), ranking.end(), [](const Ranked& a, const Ranked& b) {
+        return a.totalPnl != b.totalPnl ? a.totalPnl > b.totalPnl : a.parameterSet < b.parameterSet;
+    });
+
+    std::printf("%zu parameter sets x %zu sessions on %u threads\n\n", grid.size(), runsPerSet, threads);
+    std::printf("%4s %6s %6s %4s %9s %7s %13s %13s %9s %9s %8s %8s\n", "rank", "clones", "spread", "lot", "imbalance",
+                "skew", "total pnl", "worst pnl", "volume", "messages", "rejected", "breaches");
+    for (size_t rank = 0; rank < ranking.size() && rank < top; rank++) {
+        const Ranked& r = ranking[rank];
+        const StrategyParameters& p = grid[r.parameterSet];
+        std::printf("%4zu %6d %6lu %4lu %9ld %7.4f %13ld %13ld %9lu %9lu %8lu %8lu\n", rank + 1, p.numClones,
+                    p.additionalSpread / TICK_SIZE_IN_CENTS, p.lotSize, p.minPositionImbalance,
+                    p.centsPerImbalancedShare, r.totalPnl, r.worstPnl, r.tradedVolume, r.messages, r.rejected,
+                    r.breaches);
+    }
+
+    if (!outputPath.empty()) {
+        std::FILE* out = std::fopen(outputPath.c_str(), "w");
+        if (out == nullptr) {
+            std::fprintf(stderr, "cannot write %s\n", outputPath.c_str());
+            return 1;
+        }
+        std::fprintf(out, "rank,clones,spread_ticks,lot,imbalance,skew,total_pnl,worst_pnl,volume,messages,rejected,breaches\n");
+        for (size_t rank = 0; rank < ranking.size(); rank++) {
+            const Ranked& r = ranking[rank];
+            const StrategyParameters& p = grid[r.parameterSet];
+            std::fprintf(out, "%zu,%d,%lu,%lu,%ld,%g,%ld,%ld,%lu,%lu,%lu,%lu\n", rank + 1, p.numClones,
+                         p.additionalSpread / TICK_SIZE_IN_CENTS, p.lotSize, p.minPositionImbalance,
+                         p.centsPerImbalancedShare, r.totalPnl, r.worstPnl, r.tradedVolume, r.messages, r.rejected,
+                         r.breaches);
+        }
+        std::fclose(out);
+    }
+    return 0;
+}
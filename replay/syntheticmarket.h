@@ -0,0 +1,107 @@
+#ifndef CPPREADY_TRADER_GO_SYNTHETICMARKET_H
+#define CPPREADY_TRADER_GO_SYNTHETICMARKET_H
+
+#include <cstdint>
+#include <random>
+
+#include "constants.h"
+#include "eventrecord.h"
+
+// Background market for the local exchange when no recording is at hand.
+// The FUTURE mid follows a random walk in ticks, the ETF mid tracks it with
+// a small mean-reverting premium, and random aggressors print trade ticks
+// on the ETF. Every STEP both books are published with a shared sequence
+// number, like the real exchange does. Only the raw engine output is used,
+// so a seed produces the same market with every standard library.
+//
+// With crossesPerMille, that many steps in a thousand also shock the ETF
+// premium far enough for the books to cross, which makes the trader
+// arbitrage and then shrink its quotes to the position that leaves.
+class SyntheticMarket {
+public:
+    static constexpr std::int64_t STEP_MICROSECONDS = 250000;
+
+    SyntheticMarket(std::uint64_t seed, std::int64_t startTime, unsigned crossesPerMille = 0,
+                    unsigned long startPrice = 10000 * TICK_SIZE_IN_CENTS)
+        : mEngine(seed), mTime(startTime), mCrossesPerMille(crossesPerMille),
+          mFutureTicks(startPrice / TICK_SIZE_IN_CENTS) {}
+
+    // Produces the events of the next step: FUTURE book, ETF book and, if
+    // anything traded, ETF trade ticks
+    template<typename F>
+    void Step(F&& emit) {
+        mTime += STEP_MICROSECONDS;
+        mSequence++;
+
+        // Random walk with occasional jumps
+        unsigned roll = Uniform(1000);
+        if (roll < 150) mFutureTicks++;
+        else if (roll < 300) mFutureTicks--;
+        else if (roll < 305) mFutureTicks += 5;
+        else if (roll < 310) mFutureTicks -= 5;
+
+        // ETF premium in ticks, pulled back towards zero
+        roll = Uniform(100);
+        if (roll < 10) mPremium++;
+        else if (roll < 20) mPremium--;
+        if (mPremium > 0 && Uniform(4) == 0) mPremium--;
+        if (mPremium < 0 && Uniform(4) == 0) mPremium++;
+        // Drawn only when enabled, so the plain market stays the same per seed
+        if (mCrossesPerMille != 0 && Uniform(1000) < mCrossesPerMille)
+            mPremium = Uniform(2) == 0 ? 4 : -4;
+
+        emit(Book(FUT, mFutureTicks, 1 + Uniform(2)));
+        emit(Book(ETF, mFutureTicks + mPremium, 1 + Uniform(3)));
+        if (Uniform(3) == 0)
+            emit(Ticks(mFutureTicks + mPremium));
+    }
+
+    std::int64_t Time() const { return mTime; }
+
+private:
+    unsigned Uniform(unsigned bound) { return (unsigned)(mEngine() % bound); }
+
+    EventRecord Book(ReadyTraderGo::Instrument instrument, long midTicks, long spreadTicks) {
+        EventRecord record = Header(EventType::ORDER_BOOK, instrument);
+        long bestBid = midTicks - spreadTicks / 2;
+        for (size_t level = 0; level < EventRecord::LEVELS; level++) {
+            record.book.bidPrices[level] = (std::uint32_t)((bestBid - (long)level) * TICK_SIZE_IN_CENTS);
+            record.book.askPrices[level] = (std::uint32_t)((bestBid + spreadTicks + (long)level) * TICK_SIZE_IN_CENTS);
+            record.book.bidVolumes[level] = 10 + Uniform(200);
+            record.book.askVolumes[level] = 10 + Uniform(200);
+        }
+        return record;
+    }
+
+    // An aggressor sweeping up to three levels on one side
+    EventRecord Ticks(long midTicks) {
+        EventRecord record = Header(EventType::TRADE_TICKS, ETF);
+        bool buyer = Uniform(2) == 0;
+        unsigned levels = 1 + Uniform(3);
+        for (size_t level = 0; level < levels; level++) {
+            auto price = (std::uint32_t)((buyer ? midTicks + 1 + (long)level : midTicks - (long)level) * TICK_SIZE_IN_CENTS);
+            auto volume = (std::uint32_t)(1 + Uniform(60));
+            (buyer ? record.book.askPrices : record.book.bidPrices)[level] = price;
+            (buyer ? record.book.askVolumes : record.book.bidVolumes)[level] = volume;
+        }
+        return record;
+    }
+
+    EventRecord Header(EventType type, ReadyTraderGo::Instrument instrument) const {
+        EventRecord record{};
+        record.type = type;
+        record.instrument = (std::uint8_t)instrument;
+        record.id = mSequence;
+        record.timestamp = mTime;
+        return record;
+    }
+
+    std::mt19937_64 mEngine;
+    std::int64_t mTime;
+    const unsigned mCrossesPerMille;
+    long mFutureTicks;
+    long mPremium = 0;
+    unsigned long mSequence = 0;
+};
+
+#endif //CPPREADY_TRADER_GO_SYNTHETICMARKET_H
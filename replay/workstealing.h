@@ -0,0 +1,78 @@
+#ifndef CPPREADY_TRADER_GO_WORKSTEALING_H
+#define CPPREADY_TRADER_GO_WORKSTEALING_H
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs a fixed batch of independent jobs on a set of threads. Jobs are dealt
+// round-robin to per-worker deques; a worker takes from the front of its own
+// deque and, once that is empty, steals from the back of the others, so
+// uneven job lengths do not leave cores idle.
+class WorkStealingPool {
+public:
+    using Job = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned threads) : mQueues(threads == 0 ? 1 : threads) {
+        for (auto& queue : mQueues)
+            queue = std::make_unique<Queue>();
+    }
+
+    // Must not be called while Run is in progress
+    void Submit(Job job) {
+        mQueues[mNextQueue++ % mQueues.size()]->jobs.push_back(std::move(job));
+    }
+
+    // Runs every submitted job and returns once all have completed
+    void Run() {
+        std::vector<std::thread> workers;
+        for (size_t self = 1; self < mQueues.size(); self++)
+            workers.emplace_back([this, self] { Work(self); });
+        Work(0);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    void Work(size_t self) {
+        Job job;
+        while (Take(self, job))
+            job();
+    }
+
+    bool Take(size_t self, Job& job) {
+        {
+            Queue& own = *mQueues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.jobs.empty()) {
+                job = std::move(own.jobs.front());
+                own.jobs.pop_front();
+                return true;
+            }
+        }
+        // No new jobs appear during Run, so one pass over the victims is enough
+        for (size_t offset = 1; offset < mQueues.size(); offset++) {
+            Queue& victim = *mQueues[(self + offset) % mQueues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                job = std::move(victim.jobs.back());
+                victim.jobs.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::unique_ptr<Queue>> mQueues;
+    size_t mNextQueue = 0;
+};
+
+#endif //CPPREADY_TRADER_GO_WORKSTEALING_H
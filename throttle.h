@@ -0,0 +1,307 @@
+#ifndef CPPREADY_TRADER_GO_THROTTLE_H
+#define CPPREADY_TRADER_GO_THROTTLE_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+
+#include <ready_trader_go/types.h>
+
+#include "clock.h"
+#include "constants.h"
+#include "debug.h"
+
+// Rolling one second window over the messages we sent to the exchange.
+class MessageFrequencyTracker {
+    using arr_type = std::array<ptime, 16 * MAX_MESSAGE_FREQ>;
+    arr_type mMem;
+    arr_type::iterator mHead, mTail;
+    unsigned long mRollingMessageCount;
+public:
+    static inline const time_duration PeriodLength = boost::posix_time::seconds(1);
+
+    MessageFrequencyTracker() : mMem{}, mRollingMessageCount(0) {
+        mHead = mMem.begin();
+        mTail = mMem.begin();
+    }
+
+    void NoteMessage(ptime currentTime) {
+        // Add new message and advance pointer
+        *(mTail++) = currentTime;
+        mRollingMessageCount++;
+        if (mTail == mMem.end())
+            mTail = mMem.begin();
+        Expire(currentTime);
+        IF_DBG_RLOG(LG_AT, ReadyTraderGo::LogLevel::LL_DEBUG) << " rolling message count " << mRollingMessageCount;
+    }
+
+    // Remove timed out messages
+    void Expire(ptime currentTime) {
+        while (mRollingMessageCount != 0 && currentTime - *mHead > PeriodLength) {
+            mRollingMessageCount--;
+            if (++mHead == mMem.end())
+                mHead = mMem.begin();
+        }
+    }
+
+    // Messages that may be sent right now without breaching the limit
+    long FreeMessages(ptime currentTime) {
+        Expire(currentTime);
+        return (long)MAX_MESSAGE_FREQ - (long)mRollingMessageCount;
+    }
+
+    // Time at which the oldest message in the window stops counting
+    ptime NextRelease() const { return *mHead + PeriodLength; }
+
+    // Number of new orders that can be placed such that each of up to
+    // maxOpenOrders open orders can still be cancelled, given that
+    // pendingMessages are already queued
+    int GetNewOrdersAllowed(ptime currentTime, long maxOpenOrders, size_t pendingMessages = 0) {
+        // Figure out what message strategy is guaranteed to be compliant
+        constexpr long safetyMargin = 0;
+        long freeMessages = FreeMessages(currentTime) - (long)pendingMessages;
+        return (int)std::max(0L, (freeMessages - maxOpenOrders - safetyMargin) / 2);
+    }
+};
+
+struct OutboundMessage {
+    enum class Type : unsigned char { AMEND, CANCEL, HEDGE, INSERT };
+
+    Type type;
+    ReadyTraderGo::Side side;
+    ReadyTraderGo::Lifespan lifespan;
+    unsigned long clientOrderId, price, volume;
+    ptime queuedAt;
+};
+
+// Order in which queued messages go out once budget frees up. Cancels and
+// hedges take risk off, amends shrink orders that stay, inserts add risk.
+enum class Urgency : unsigned char { RISK_REDUCING, AMEND, NEW_ORDER, COUNT };
+
+inline Urgency UrgencyOf(OutboundMessage::Type type) {
+    switch (type) {
+    case OutboundMessage::Type::CANCEL:
+    case OutboundMessage::Type::HEDGE:
+        return Urgency::RISK_REDUCING;
+    case OutboundMessage::Type::AMEND:
+        return Urgency::AMEND;
+    default:
+        return Urgency::NEW_ORDER;
+    }
+}
+
+struct ThrottleStats {
+    unsigned long sentImmediately = 0;
+    unsigned long queued = 0;
+    unsigned long drained = 0;
+    unsigned long coalesced = 0;  // queued messages superseded before they went out
+    unsigned long withdrawn = 0;  // queued inserts cancelled before they went out
+    size_t maxQueueDepth = 0;
+    time_duration totalWait;
+    time_duration maxWait;
+};
+
+// Token bucket in front of the execution connection. A token is returned
+// exactly one period after it was spent, mirroring the exchange's rolling
+// window (a constant-rate refill would let 2x MAX_MESSAGE_FREQ through in
+// some windows). Messages over budget are queued by urgency and released by
+// a steady_timer on the io_context, so the reactor never blocks.
+//
+// Under pressure risk comes off before it is added: the most urgent queue
+// drains first, and a message never overtakes a queued one of the same or
+// higher urgency. Requests for an order that is still queued are folded
+// into it, so a later amend replaces an earlier one or shrinks the queued
+// insert, and a cancel drops the queued amend, or the insert altogether.
+// Amends and cancels then never go out ahead of their order's insert.
+class MessageThrottle {
+public:
+    using Dispatcher = std::function<void(const OutboundMessage&)>;
+    static constexpr size_t QUEUE_CAPACITY = 16 * MAX_MESSAGE_FREQ;  // per urgency
+
+    // withdrawn is told about inserts that were cancelled while still
+    // queued, the exchange will never send a status for them
+    MessageThrottle(boost::asio::io_context& context, const Clock& clock, Dispatcher dispatcher,
+                    Dispatcher withdrawn = nullptr)
+        : mClock(clock), mTimer(context), mDispatcher(std::move(dispatcher)), mWithdrawn(std::move(withdrawn)) {}
+
+    // Returns true if message may be sent right away, in which case it has
+    // already been counted. Otherwise the message is queued, or folded into
+    // a queued one, and will be handed to the dispatcher once the budget
+    // allows.
+    bool Admit(const OutboundMessage& message) {
+        ptime now = Now();
+        if (mQueueSize != 0 && Coalesce(message))
+            return false;
+        const size_t urgency = (size_t)UrgencyOf(message.type);
+        if (QueuedUpTo(urgency) == 0 && mTracker.FreeMessages(now) > 0) {
+            mTracker.NoteMessage(now);
+            mStats.sentImmediately++;
+            return true;
+        }
+        Queue& queue = mQueues[urgency];
+        if (queue.size == QUEUE_CAPACITY) {
+            // Never drop a message, a lost cancel or hedge is worse than a breach
+            IF_DBG_RLOG(LG_AT, ReadyTraderGo::LogLevel::LL_ERROR) << " outbound queue full, sending without budget";
+            mTracker.NoteMessage(now);
+            return true;
+        }
+        Entry& slot = queue.At(queue.size++);
+        slot.message = message;
+        slot.message.queuedAt = now;
+        slot.superseded = false;
+        queue.live++;
+        mQueueSize++;
+        mStats.queued++;
+        mStats.maxQueueDepth = std::max(mStats.maxQueueDepth, mQueueSize);
+        IF_DBG_RLOG(LG_AT, ReadyTraderGo::LogLevel::LL_WARNING) << " message budget exhausted, queue depth " << mQueueSize;
+        ArmTimer(now);
+        return false;
+    }
+
+    // Messages that can still go out in the current window, net of the queue
+    long FreeMessages() { return mTracker.FreeMessages(Now()) - (long)mQueueSize; }
+
+    size_t QueueDepth() const { return mQueueSize; }
+    const ThrottleStats& Stats() const { return mStats; }
+
+    // Earliest time at which Drain can release a queued message, or
+    // not_a_date_time if the queue is empty. Lets simulations that do not
+    // run the io_context drive the queue themselves.
+    ptime NextDrainTime() const {
+        return mQueueSize == 0 ? ptime(boost::posix_time::not_a_date_time) : mTracker.NextRelease() + TimerMargin;
+    }
+
+    // Sends as many queued messages as the budget allows, most urgent first
+    void Drain() {
+        ptime now = Now();
+        while (mQueueSize != 0 && mTracker.FreeMessages(now) > 0) {
+            OutboundMessage message = Pop();
+            mTracker.NoteMessage(now);
+            time_duration waited = now - message.queuedAt;
+            mStats.drained++;
+            mStats.totalWait += waited;
+            mStats.maxWait = std::max(mStats.maxWait, waited);
+            mDispatcher(message);
+        }
+        if (mQueueSize != 0)
+            ArmTimer(now);
+    }
+
+private:
+    // Superseded entries stay in place until they reach the head
+    struct Entry {
+        OutboundMessage message;
+        bool superseded;
+    };
+
+    struct Queue {
+        std::array<Entry, QUEUE_CAPACITY> entries{};
+        size_t head = 0, size = 0;  // size includes superseded entries
+        size_t live = 0;
+
+        Entry& At(size_t n) { return entries[(head + n) % QUEUE_CAPACITY]; }
+    };
+
+    ptime Now() const { return mClock.Now(); }
+
+    size_t QueuedUpTo(size_t urgency) const {
+        size_t queued = 0;
+        for (size_t u = 0; u <= urgency; u++)
+            queued += mQueues[u].live;
+        return queued;
+    }
+
+    // Removes the most urgent live message, mQueueSize must not be zero
+    OutboundMessage Pop() {
+        for (Queue& queue : mQueues) {
+            while (queue.size != 0) {
+                Entry& entry = queue.At(0);
+                queue.head = (queue.head + 1) % QUEUE_CAPACITY;
+                queue.size--;
+                if (entry.superseded)
+                    continue;
+                queue.live--;
+                mQueueSize--;
+                return entry.message;
+            }
+        }
+        return OutboundMessage{};
+    }
+
+    Entry* Find(Urgency urgency, unsigned long clientOrderId) {
+        Queue& queue = mQueues[(size_t)urgency];
+        for (size_t n = 0; n < queue.size; n++) {
+            Entry& entry = queue.At(n);
+            if (!entry.superseded && entry.message.clientOrderId == clientOrderId)
+                return &entry;
+        }
+        return nullptr;
+    }
+
+    void Supersede(Urgency urgency, Entry& entry) {
+        entry.superseded = true;
+        mQueues[(size_t)urgency].live--;
+        mQueueSize--;
+        mStats.coalesced++;
+    }
+
+    // Folds message into what is queued for the same order. Returns true if
+    // nothing is left to send for it.
+    bool Coalesce(const OutboundMessage& message) {
+        if (message.type == OutboundMessage::Type::AMEND) {
+            if (Entry* queued = Find(Urgency::NEW_ORDER, message.clientOrderId)) {
+                queued->message.volume = std::min(queued->message.volume, message.volume);
+                mStats.coalesced++;
+                return true;
+            }
+            if (Entry* queued = Find(Urgency::AMEND, message.clientOrderId)) {
+                queued->message.volume = message.volume;
+                mStats.coalesced++;
+                return true;
+            }
+        } else if (message.type == OutboundMessage::Type::CANCEL) {
+            if (Entry* queued = Find(Urgency::NEW_ORDER, message.clientOrderId)) {
+                // Never reached the exchange, so there is nothing to cancel
+                Supersede(Urgency::NEW_ORDER, *queued);
+                mStats.withdrawn++;
+                if (mWithdrawn)
+                    mWithdrawn(queued->message);
+                return true;
+            }
+            if (Entry* queued = Find(Urgency::AMEND, message.clientOrderId))
+                Supersede(Urgency::AMEND, *queued);
+        }
+        return false;
+    }
+
+    void ArmTimer(ptime now) {
+        if (mTimerArmed)
+            return;
+        mTimerArmed = true;
+        time_duration wait = mTracker.NextRelease() - now + TimerMargin;
+        mTimer.expires_after(std::chrono::microseconds(std::max(0L, (long)wait.total_microseconds())));
+        mTimer.async_wait([this](const boost::system::error_code& error) {
+            mTimerArmed = false;
+            if (!error)
+                Drain();
+        });
+    }
+
+    // Fire slightly after the oldest message left the window
+    static inline const time_duration TimerMargin = boost::posix_time::milliseconds(5);
+
+    const Clock& mClock;
+    MessageFrequencyTracker mTracker;
+    boost::asio::steady_timer mTimer;
+    Dispatcher mDispatcher, mWithdrawn;
+    bool mTimerArmed = false;
+    std::array<Queue, (size_t)Urgency::COUNT> mQueues;
+    size_t mQueueSize = 0;  // live messages over all queues
+    ThrottleStats mStats;
+};
+
+#endif //CPPREADY_TRADER_GO_THROTTLE_H